@@ -0,0 +1,141 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "vector.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: AABB
+	//-------------------------------------------------------------------------
+
+	struct AABB {
+
+	public:
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		// An empty box (which any point or box extends).
+		constexpr AABB() noexcept
+			: m_min(std::numeric_limits< double >::infinity()),
+			m_max(-std::numeric_limits< double >::infinity()) {}
+		constexpr explicit AABB(Vector3 min, Vector3 max) noexcept
+			: m_min(std::move(min)),
+			m_max(std::move(max)) {}
+		constexpr AABB(const AABB& aabb) noexcept = default;
+		constexpr AABB(AABB&& aabb) noexcept = default;
+		~AABB() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		AABB& operator=(const AABB& aabb) = default;
+		AABB& operator=(AABB&& aabb) = default;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		[[nodiscard]]
+		constexpr bool IsEmpty() const noexcept {
+			return m_min.m_x > m_max.m_x
+				|| m_min.m_y > m_max.m_y
+				|| m_min.m_z > m_max.m_z;
+		}
+
+		constexpr AABB& Extend(const Vector3& p) noexcept {
+			m_min = Min(m_min, p);
+			m_max = Max(m_max, p);
+			return *this;
+		}
+
+		constexpr AABB& Extend(const AABB& aabb) noexcept {
+			m_min = Min(m_min, aabb.m_min);
+			m_max = Max(m_max, aabb.m_max);
+			return *this;
+		}
+
+		[[nodiscard]]
+		constexpr const Vector3 Centroid() const noexcept {
+			return 0.5 * (m_min + m_max);
+		}
+
+		[[nodiscard]]
+		constexpr const Vector3 Diagonal() const noexcept {
+			return m_max - m_min;
+		}
+
+		[[nodiscard]]
+		constexpr double SurfaceArea() const noexcept {
+			if (IsEmpty()) {
+				return 0.0;
+			}
+
+			const Vector3 d = Diagonal();
+			return 2.0 * (d.m_x * d.m_y + d.m_y * d.m_z + d.m_z * d.m_x);
+		}
+
+		// Slab test of the ray o + t * d, given inv_d = 1 / d, against this box
+		// on the interval [tmin, tmax]. Stores the entry distance in t_entry.
+		[[nodiscard]]
+		bool Intersect(const Vector3& o,
+					   const Vector3& inv_d,
+					   double tmin,
+					   double tmax,
+					   double& t_entry) const noexcept {
+
+			// Widening the exit distance makes the test conservative with
+			// respect to the rounding errors of the slab distances.
+			constexpr double exit_scale = 1.0 + 6.0 * std::numeric_limits< double >::epsilon();
+
+			for (std::size_t i = 0u; i < 3u; ++i) {
+				double t0 = (m_min[i] - o[i]) * inv_d[i];
+				double t1 = (m_max[i] - o[i]) * inv_d[i];
+				if (t0 > t1) {
+					std::swap(t0, t1);
+				}
+				t1 *= exit_scale;
+
+				// A NaN slab distance (0 * inf) leaves the interval unchanged.
+				tmin = (t0 > tmin) ? t0 : tmin;
+				tmax = (t1 < tmax) ? t1 : tmax;
+				if (tmin > tmax) {
+					return false;
+				}
+			}
+
+			t_entry = tmin;
+			return true;
+		}
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		Vector3 m_min;
+		Vector3 m_max;
+	};
+}
@@ -4,9 +4,17 @@
 #pragma region
 
 #include "imageio.hpp"
+#include "light.hpp"
+#include "particles.hpp"
+#include "pixel_statistics.hpp"
+#include "precision.hpp"
+#include "progressive.hpp"
 #include "sampling.hpp"
+#include "scene.hpp"
 #include "specular.hpp"
-#include "sphere.hpp"
+#include "static_scene.hpp"
+#include "tile.hpp"
+#include "wavefront.hpp"
 
 #pragma endregion
 
@@ -15,19 +23,17 @@
 //-----------------------------------------------------------------------------
 #pragma region
 
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <iterator>
 #include <memory>
 #include <optional>
-
-#pragma endregion
-
-//-----------------------------------------------------------------------------
-// Defines
-//-----------------------------------------------------------------------------
-#pragma region
-
-#define REFRACTIVE_INDEX_OUT 1.0
-#define REFRACTIVE_INDEX_IN  1.5
+#include <span>
+#include <vector>
 
 #pragma endregion
 
@@ -48,40 +54,106 @@ namespace smallpt {
 		Sphere(600,	 Vector3(50, 681.6 - .27, 81.6), Vector3(12), Vector3(),               Reflection_t::Diffuse)	 //Light
 	};
 
+	// The walls of the room above (its first six spheres) as planes facing
+	// the room, and the other spheres.
+	constexpr Plane g_walls[] = {
+		Plane(Vector3(1.0, 0.0, 0.0),  1.0,    Vector3(), Vector3(0.75,0.25,0.25), Reflection_t::Diffuse),	 //Left
+		Plane(Vector3(-1.0, 0.0, 0.0), -99.0,  Vector3(), Vector3(0.25,0.25,0.75), Reflection_t::Diffuse),	 //Right
+		Plane(Vector3(0.0, 0.0, 1.0),  0.0,    Vector3(), Vector3(0.75),           Reflection_t::Diffuse),	 //Back
+		Plane(Vector3(0.0, 0.0, -1.0), -170.0, Vector3(), Vector3(),               Reflection_t::Diffuse),	 //Front
+		Plane(Vector3(0.0, 1.0, 0.0),  0.0,    Vector3(), Vector3(0.75),           Reflection_t::Diffuse),	 //Bottom
+		Plane(Vector3(0.0, -1.0, 0.0), -81.6,  Vector3(), Vector3(0.75),           Reflection_t::Diffuse)	 //Top
+	};
+	constexpr std::span< const Sphere > g_objects(std::begin(g_spheres) + std::size(g_walls), std::end(g_spheres));
+
+	// The objects as a structure of arrays in BVH order, intersected with the
+	// widest SIMD kernels the CPU supports, and the walls. main may replace it.
+	static Scene g_scene(g_objects, g_walls);
+
 	[[nodiscard]]
-	constexpr std::optional< std::size_t > Intersect(const Ray& ray) noexcept {
-		std::optional< size_t > hit;
-		for (std::size_t i = 0u; i < std::size(g_spheres); ++i) {
-			if (g_spheres[i].Intersect(ray)) {
-				hit = i;
+	inline std::optional< std::size_t > Intersect(const Ray& ray) noexcept {
+		return g_scene.Intersect(ray);
+	}
+
+	// How Radiance gathers the light of the emissive spheres at diffuse hits
+	// (see LightSampling_t). main may set it.
+	static LightSampling_t g_light_sampling = LightSampling_t::None;
+
+	// The radiance reflected at p, with oriented normal w, by a white Lambertian
+	// surface from the emissive spheres of g_scene: for each, one direction
+	// sampled over the cone it subtends with a shadow ray, weighted against 
+	// sampling the same direction with the BSDF (see LightSamplingWeight).
+	[[nodiscard]]
+	static const Vector3 SampleLights(const Vector3& p, 
+									  const Vector3& w, 
+									  std::uint32_t depth, 
+									  RNG& rng) noexcept {
+		Vector3 L;
+		for (const Sphere& light : g_scene.GetLights()) {
+			const std::optional< LightSample > sample 
+				= SampleSphereLight(light, p, rng.Uniform(), rng.Uniform());
+			if (!sample) {
+				continue; // p lies within the light
+			}
+			const double cos_theta = w.Dot(sample->m_d);
+			if (0.0 >= cos_theta) {
+				continue;
 			}
+
+			const Ray shadow_ray(p, sample->m_d, EPSILON_SPHERE, INFINITY, depth + 1u);
+			if (!light.Intersect(shadow_ray) 
+				|| g_scene.Occluded(shadow_ray, shadow_ray.m_tmax - EPSILON_SPHERE)) {
+				continue;
+			}
+
+			// Le * (1 / pi) * cos_theta / pdf, where (1 / pi) * cos_theta is
+			// also the density of the BSDF sampling.
+			const double bsdf_pdf = CosineWeightedHemispherePdf(cos_theta);
+			const double weight   = LightSamplingWeight(g_light_sampling, sample->m_pdf, bsdf_pdf);
+			L += light.m_e * (weight * bsdf_pdf / sample->m_pdf);
 		}
-		
-		return hit;
+		return L;
 	}
 
+	// The radiance arriving along the given ray, whose first hit has already
+	// been determined (setting ray.m_tmax), e.g. as part of a packet.
 	[[nodiscard]]
-	static const Vector3 Radiance(const Ray& ray, RNG& rng) noexcept {
+	static const Vector3 Radiance(const Ray& ray, 
+								  std::optional< std::size_t > hit, 
+								  RNG& rng) noexcept {
 		Ray r = ray;
 		Vector3 L;
 		Vector3 F(1.0);
+		// The last hit and the density with which it sampled r if it sampled
+		// the lights too, 0 otherwise.
+		Vector3 bsdf_p;
+		double bsdf_pdf = 0.0;
 
 		while (true) {
-			const auto hit = Intersect(r);
 			if (!hit) {
 				return L;
 			}
 
-			const Sphere& shape = g_spheres[hit.value()];
+			const Material& material = g_scene.GetMaterial(hit.value());
 			const Vector3 p = r(r.m_tmax);
-			const Vector3 n = Normalize(p - shape.m_p);
+			const Vector3 n = g_scene.GetNormal(hit.value(), p);
 
-			L += F * shape.m_e;
-			F *= shape.m_f;
+			if (0.0 < bsdf_pdf 
+				&& hit.value() < g_scene.GetNumberOfSpheres() 
+				&& Vector3() != material.m_e) {
+				// The share of BSDF sampling in the light of this sphere.
+				const double light_pdf = SphereLightPdf(g_scene.GetSphere(hit.value()), bsdf_p);
+				L += F * material.m_e * (1.0 - LightSamplingWeight(g_light_sampling, light_pdf, bsdf_pdf));
+			}
+			else {
+				L += F * material.m_e;
+			}
+			F *= material.m_f;
+			bsdf_pdf = 0.0;
 
 			// Russian roulette
 			if (4u < r.m_depth) {
-				const double continue_probability = shape.m_f.Max();
+				const double continue_probability = material.m_f.Max();
 				if (rng.Uniform() >= continue_probability) {
 					return L;
 				}
@@ -89,7 +161,7 @@ namespace smallpt {
 			}
 
 			// Next path segment
-			switch (shape.m_reflection_t) {
+			switch (material.m_reflection_t) {
 			
 			case Reflection_t::Specular: {
 				const Vector3 d = IdealSpecularReflect(r.m_d, n);
@@ -99,7 +171,7 @@ namespace smallpt {
 			
 			case Reflection_t::Refractive: {
 				double pr;
-				const Vector3 d = IdealSpecularTransmit(r.m_d, n, REFRACTIVE_INDEX_OUT, REFRACTIVE_INDEX_IN, pr, rng);
+				const Vector3 d = IdealSpecularTransmit(r.m_d, n, g_refractive_index_out, g_refractive_index_in, pr, rng);
 				F *= pr;
 				r = Ray(p, d, EPSILON_SPHERE, INFINITY, r.m_depth + 1u);
 				break;
@@ -110,17 +182,179 @@ namespace smallpt {
 				const Vector3 u = Normalize((std::abs(w.m_x) > 0.1 ? Vector3(0.0, 1.0, 0.0) : Vector3(1.0, 0.0, 0.0)).Cross(w));
 				const Vector3 v = w.Cross(u);
 
+				if (LightSampling_t::None != g_light_sampling) {
+					L += F * SampleLights(p, w, r.m_depth, rng);
+				}
+
 				const Vector3 sample_d = CosineWeightedSampleOnHemisphere(rng.Uniform(), rng.Uniform());
 				const Vector3 d = Normalize(sample_d.m_x * u + sample_d.m_y * v + sample_d.m_z * w);
+				if (LightSampling_t::None != g_light_sampling) {
+					bsdf_p   = p;
+					bsdf_pdf = CosineWeightedHemispherePdf(sample_d.m_z);
+				}
 				r = Ray(p, d, EPSILON_SPHERE, INFINITY, r.m_depth + 1u);
 				break;
 			}
 			
 			}
+
+			hit = Intersect(r);
+		}
+	}
+
+	// Traces the camera rays of a packet together up to their first hit, and
+	// then each path on its own. The radiance of the ray in lane k is added 
+	// to L_subpixels[subpixels[k]].
+	static void TracePacket(RayPacket& packet, 
+							const std::uint8_t* subpixels, 
+							RNG& rng, 
+							Vector3* L_subpixels) noexcept {
+		g_scene.Intersect(packet);
+		for (std::size_t lane = 0u; lane < packet.size(); ++lane) {
+			L_subpixels[subpixels[lane]] += Radiance(packet.GetRay(lane), packet.GetHit(lane), rng);
+		}
+		packet.clear();
+	}
+
+	// The Cornell box compiled into the binary (see StaticScene), with the 
+	// walls as planes or as the original spheres.
+	using StaticCornellBox       = StaticScene< g_objects, g_walls >;
+	using StaticSphereCornellBox = StaticScene< g_spheres >;
+
+	// Radiance for a scene fixed at compile time, tracing the ray from its
+	// origin on. The shading is instantiated per primitive for its constant
+	// material: only emitters add emission, Russian roulette only draws for
+	// surfaces that absorb light, and the paths end at black surfaces.
+	template< typename SceneT >
+	[[nodiscard]]
+	static const Vector3 StaticRadiance(const Ray& ray, RNG& rng) noexcept {
+		Ray r = ray;
+		Vector3 L;
+		Vector3 F(1.0);
+
+		for (bool active = true; active; ) {
+			const std::optional< std::size_t > hit = SceneT::Intersect(r);
+			if (!hit) {
+				return L;
+			}
+
+			SceneT::Visit(hit.value(), [&r, &L, &F, &active, &rng]< std::size_t I >() noexcept {
+				constexpr Material material = SceneT::template GetMaterial< I >();
+
+				if constexpr (Vector3() != material.m_e) {
+					L += F * material.m_e;
+				}
+				if constexpr (Vector3() == material.m_f) {
+					active = false;
+					return;
+				}
+				F *= material.m_f;
+
+				// Russian roulette
+				constexpr double continue_probability = material.m_f.Max();
+				if constexpr (1.0 > continue_probability) {
+					if (4u < r.m_depth) {
+						if (rng.Uniform() >= continue_probability) {
+							active = false;
+							return;
+						}
+						F /= continue_probability;
+					}
+				}
+
+				const Vector3 p = r(r.m_tmax);
+				const Vector3 n = SceneT::template GetNormal< I >(p);
+
+				// Next path segment
+				if constexpr (Reflection_t::Specular == material.m_reflection_t) {
+					const Vector3 d = IdealSpecularReflect(r.m_d, n);
+					r = Ray(p, d, EPSILON_SPHERE, INFINITY, r.m_depth + 1u);
+				}
+				else if constexpr (Reflection_t::Refractive == material.m_reflection_t) {
+					double pr;
+					const Vector3 d = IdealSpecularTransmit(r.m_d, n, g_refractive_index_out, g_refractive_index_in, pr, rng);
+					F *= pr;
+					r = Ray(p, d, EPSILON_SPHERE, INFINITY, r.m_depth + 1u);
+				}
+				else {
+					const Vector3 w = (0.0 > n.Dot(r.m_d)) ? n : -n;
+					const Vector3 u = Normalize((std::abs(w.m_x) > 0.1 ? Vector3(0.0, 1.0, 0.0) : Vector3(1.0, 0.0, 0.0)).Cross(w));
+					const Vector3 v = w.Cross(u);
+
+					const Vector3 sample_d = CosineWeightedSampleOnHemisphere(rng.Uniform(), rng.Uniform());
+					const Vector3 d = Normalize(sample_d.m_x * u + sample_d.m_y * v + sample_d.m_z * w);
+					r = Ray(p, d, EPSILON_SPHERE, INFINITY, r.m_depth + 1u);
+				}
+			});
+		}
+
+		return L;
+	}
+
+	// TracePacket for a scene fixed at compile time: each path is traced on
+	// its own from the camera on, with StaticRadiance.
+	template< typename SceneT >
+	static void TraceStaticPacket(RayPacket& packet, 
+								  const std::uint8_t* subpixels, 
+								  RNG& rng, 
+								  Vector3* L_subpixels) noexcept {
+		for (std::size_t lane = 0u; lane < packet.size(); ++lane) {
+			L_subpixels[subpixels[lane]] += StaticRadiance< SceneT >(packet.GetRay(lane), rng);
+		}
+		packet.clear();
+	}
+
+	using TracePacketFunction = void (*)(RayPacket&, const std::uint8_t*, RNG&, Vector3*) noexcept;
+
+	// How Render traces its packets: through g_scene, or through a scene 
+	// compiled into the binary. main may replace it.
+	static TracePacketFunction g_trace_packet = &TracePacket;
+
+	// Traces the camera rays of a packet of pixel i with g_trace_packet, adds
+	// the radiance of the ray in lane k to L_subpixels[subpixels[k]], and
+	// adds every sample to the pixel statistics if any.
+	static void TracePixelPacket(RayPacket& packet, 
+								 const std::uint8_t* subpixels, 
+								 RNG& rng, 
+								 Vector3* L_subpixels, 
+								 PixelStatistics* statistics, 
+								 std::size_t i) noexcept {
+		if (!statistics) {
+			g_trace_packet(packet, subpixels, rng, L_subpixels);
+			return;
+		}
+
+		static constexpr std::array< std::uint8_t, g_packet_size > lanes = []() noexcept {
+			std::array< std::uint8_t, g_packet_size > lanes = {};
+			for (std::size_t k = 0u; k < g_packet_size; ++k) {
+				lanes[k] = static_cast< std::uint8_t >(k);
+			}
+			return lanes;
+		}();
+
+		const std::size_t nb_lanes = packet.size();
+		Vector3 L_lanes[g_packet_size];
+		g_trace_packet(packet, lanes.data(), rng, L_lanes);
+		for (std::size_t k = 0u; k < nb_lanes; ++k) {
+			L_subpixels[subpixels[k]] += L_lanes[k];
+			statistics->Add(i, L_lanes[k]);
 		}
 	}
 
-	static void Render(std::uint32_t nb_samples) noexcept {
+	// Renders nb_samples samples per subpixel, in passes if progressive, and
+	// reports the statistics of the samples of every pixel if asked to (see
+	// PixelStatistics). Unless max_relative_error is 0, the passes after the
+	// first (base) one only render the tiles whose relative error exceeds 
+	// it (see UpdateActiveTiles), up to nb_samples.
+	static void Render(std::uint32_t nb_samples, 
+					   std::uint32_t tile_size, 
+					   TileOrder tile_order, 
+					   bool progressive, 
+					   bool report_pixel_statistics, 
+					   double max_relative_error, 
+					   bool report_tile_costs, 
+					   const CancellationToken& token, 
+					   const PassCallback& on_pass) noexcept {
 		RNG rng;
 
 		const std::uint32_t w = 1024u;
@@ -132,45 +366,422 @@ namespace smallpt {
 		const Vector3 cx   = { w * fov / h, 0.0, 0.0 };
 		const Vector3 cy   = Normalize(cx.Cross(gaze)) * fov;
 
+		const std::size_t nb_nodes      = g_scene.GetBVH().GetNumberOfNodes();
+		const std::size_t nb_wide_nodes = g_scene.GetWideBVH().GetNumberOfNodes();
+		fprintf(stderr, "Scene: %zu spheres, %zu planes, %zu binary BVH nodes (%.1f MiB), %zu wide BVH nodes (%.1f MiB), %s intersection kernels\n", 
+				g_scene.GetNumberOfSpheres(), g_scene.GetNumberOfPlanes(), 
+				nb_nodes, nb_nodes * sizeof(BVHNode) / 1048576.0, 
+				nb_wide_nodes, nb_wide_nodes * sizeof(WideBVHNode) / 1048576.0, 
+				ToString(g_scene.GetSimdLevel()));
+
+		// The radiance sums of the 2x2 subpixels of each pixel.
+		std::unique_ptr< Vector3[] > Ls_sums(new Vector3[4u * w * h]);
 		std::unique_ptr< Vector3[] > Ls(new Vector3[w * h]);
 
-		for (std::size_t y = 0u; y < h; ++y) { // pixel row
+		const std::vector< Tile > tiles = GenerateTiles(w, h, tile_size, tile_order);
+		std::vector< double > tile_costs(tiles.size());
+		std::vector< std::uint32_t > tile_nb_samples(tiles.size());
+
+		// Adaptive sampling decides from the statistics of the pixels.
+		const bool adaptive = 0.0 < max_relative_error;
+		std::optional< PixelStatistics > pixel_statistics;
+		if (report_pixel_statistics || adaptive) {
+			pixel_statistics.emplace(std::size_t(w) * h);
+		}
+		std::vector< bool > active_tiles(tiles.size(), true);
+		std::size_t nb_active_tiles = tiles.size();
+
+		std::uint32_t nb_samples_done = 0u;
+		for (std::uint32_t pass = 0u; nb_samples_done < nb_samples && !token.IsCancelled(); ++pass) {
+			// Adaptive renders start with a base pass of a few samples, and 
+			// then double them every pass like progressive ones.
+			const std::uint32_t nb_pass_samples 
+				= (adaptive && 0u == pass) ? std::min(g_nb_adaptive_base_samples, nb_samples) 
+				: (progressive || adaptive) ? NextPassSamples(nb_samples_done, nb_samples) : nb_samples;
+			if (adaptive && 0u < pass) {
+				nb_active_tiles = UpdateActiveTiles(*pixel_statistics, tiles, w, h, max_relative_error, active_tiles);
+				if (0u == nb_active_tiles) {
+					break;
+				}
+			}
+
+			for (std::size_t t = 0u; t < tiles.size() && !token.IsCancelled(); ++t) { // tile
+				if (!active_tiles[t]) {
+					continue;
+				}
 			
-			fprintf(stderr, "\rRendering (%u spp) %5.2f%%", nb_samples * 4, 100.0 * y / (h - 1));
+				fprintf(stderr, "\rRendering (%u/%u spp) %5.2f%%", 
+						(nb_samples_done + nb_pass_samples) * 4, nb_samples * 4, 100.0 * (t + 1u) / tiles.size());
 			
-			for (std::size_t x = 0u; x < w; ++x) { // pixel column
+				const Tile& tile = tiles[t];
+				const auto start = std::chrono::steady_clock::now();
+
+				for (std::size_t y = tile.m_y0; y < tile.m_y1; ++y) { // pixel row
 				
-				for (std::size_t sy = 0u, i = (h - 1u - y) * w + x; sy < 2u; ++sy) { // 2 subpixel row
+					for (std::size_t x = tile.m_x0; x < tile.m_x1; ++x) { // pixel column
 					
-					for (std::size_t sx = 0u; sx < 2u; ++sx) { // 2 subpixel column
-						
-						Vector3 L;
+						const std::size_t i = (h - 1u - y) * w + x;
+
+						// The camera rays of the pixel, in packets.
+						RayPacket packet;
+						std::uint8_t subpixels[g_packet_size];
+						Vector3 L_subpixels[4];
+
+						for (std::size_t sy = 0u; sy < 2u; ++sy) { // 2 subpixel row
 						
-						for (std::size_t s = 0u; s < nb_samples; ++s) { // samples per subpixel
+							for (std::size_t sx = 0u; sx < 2u; ++sx) { // 2 subpixel column
 							
-							const double u1 = 2.0 * rng.Uniform();
-							const double u2 = 2.0 * rng.Uniform();
-							const double dx = u1 < 1.0 ? sqrt(u1) - 1.0 : 1.0 - sqrt(2.0 - u1);
-							const double dy = u2 < 1.0 ? sqrt(u2) - 1.0 : 1.0 - sqrt(2.0 - u2);
-							const Vector3 d = cx * (((sx + 0.5 + dx) * 0.5 + x) / w - 0.5) + 
-								              cy * (((sy + 0.5 + dy) * 0.5 + y) / h - 0.5) + gaze;
-							
-							L += Radiance(Ray(eye + d * 130.0, Normalize(d), EPSILON_SPHERE), rng) * (1.0 / nb_samples);
+								for (std::size_t s = 0u; s < nb_pass_samples; ++s) { // samples per subpixel
+								
+									const double u1 = 2.0 * rng.Uniform();
+									const double u2 = 2.0 * rng.Uniform();
+									const double dx = u1 < 1.0 ? sqrt(u1) - 1.0 : 1.0 - sqrt(2.0 - u1);
+									const double dy = u2 < 1.0 ? sqrt(u2) - 1.0 : 1.0 - sqrt(2.0 - u2);
+									const Vector3 d = cx * (((sx + 0.5 + dx) * 0.5 + x) / w - 0.5) + 
+										              cy * (((sy + 0.5 + dy) * 0.5 + y) / h - 0.5) + gaze;
+								
+									subpixels[packet.size()] = static_cast< std::uint8_t >(2u * sy + sx);
+									packet.push_back(Ray(eye + d * 130.0, Normalize(d), EPSILON_SPHERE));
+									if (packet.full()) {
+										TracePixelPacket(packet, subpixels, rng, L_subpixels, pixel_statistics ? &*pixel_statistics : nullptr, i);
+									}
+								}
+							}
+						}
+
+						if (!packet.empty()) {
+							TracePixelPacket(packet, subpixels, rng, L_subpixels, pixel_statistics ? &*pixel_statistics : nullptr, i);
 						}
 
-						Ls[i] += 0.25 * Clamp(L);
+						for (std::size_t k = 0u; k < 4u; ++k) { // subpixel
+							Ls_sums[4u * i + k] += L_subpixels[k];
+						}
 					}
 				}
+
+				tile_costs[t] += std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+				tile_nb_samples[t] += nb_pass_samples;
+			}
+
+			if (token.IsCancelled()) {
+				break;
+			}
+
+			nb_samples_done += nb_pass_samples;
+			if (on_pass) {
+				ResolveTiles(tiles, tile_nb_samples, w, h, Ls_sums.get(), Ls.get());
+				on_pass(pass, nb_samples_done, w, h, Ls.get());
 			}
 		}
 
+		fprintf(stderr, "\n");
+		if (token.IsCancelled()) {
+			fprintf(stderr, "Cancelled after %u spp\n", nb_samples_done * 4);
+		}
+		if (report_tile_costs) {
+			PrintTileCosts(tile_costs);
+			WriteTileCosts(tiles, tile_costs);
+		}
+		if (report_pixel_statistics) {
+			PrintPixelStatistics(*pixel_statistics);
+		}
+		if (adaptive) {
+			fprintf(stderr, "Adaptive sampling: %zu of %zu tiles stopped below %u spp\n", 
+					tiles.size() - nb_active_tiles, tiles.size(), nb_samples * 4);
+			WriteSampleMap(w, h, pixel_statistics->GetSampleCounts());
+		}
+
+		ResolveTiles(tiles, tile_nb_samples, w, h, Ls_sums.get(), Ls.get());
+		WritePPM(w, h, Ls.get());
+	}
+
+	// Renders the image of Render with the paths traced stage by stage by a
+	// Wavefront (of the given capacity, sorting the rays or not), instead of
+	// one at a time by Radiance, and reports the ray throughput.
+	template< typename ParallelForT = SerialFor >
+	static void RenderWavefront(std::uint32_t nb_samples, 
+								std::size_t capacity, 
+								bool sort_rays, 
+								const ParallelForT& parallel_for = {}) {
+		const std::uint32_t w = 1024u;
+		const std::uint32_t h = 768u;
+
+		const Vector3 eye  = { 50.0, 52.0, 295.6 };
+		const Vector3 gaze = Normalize(Vector3(0.0, -0.042612, -1.0));
+		const double fov   = 0.5135;
+		const Vector3 cx   = { w * fov / h, 0.0, 0.0 };
+		const Vector3 cy   = Normalize(cx.Cross(gaze)) * fov;
+
+		// The radiance sums of the 2x2 subpixels of each pixel.
+		std::unique_ptr< Vector3[] > Ls_sums(new Vector3[4u * w * h]);
+		std::unique_ptr< Vector3[] > Ls(new Vector3[w * h]);
+
+		// Path k is sample k % nb_samples of subpixel (k / nb_samples) % 4 of
+		// pixel k / (4 * nb_samples), row by row.
+		const auto generate = [=](std::size_t k, RNG& rng) noexcept {
+			const std::size_t subpixel = (k / nb_samples) % 4u;
+			const std::size_t pixel    = k / (4u * nb_samples);
+			const std::size_t x  = pixel % w;
+			const std::size_t y  = pixel / w;
+			const std::size_t sx = subpixel % 2u;
+			const std::size_t sy = subpixel / 2u;
+
+			const double u1 = 2.0 * rng.Uniform();
+			const double u2 = 2.0 * rng.Uniform();
+			const double dx = u1 < 1.0 ? sqrt(u1) - 1.0 : 1.0 - sqrt(2.0 - u1);
+			const double dy = u2 < 1.0 ? sqrt(u2) - 1.0 : 1.0 - sqrt(2.0 - u2);
+			const Vector3 d = cx * (((sx + 0.5 + dx) * 0.5 + x) / w - 0.5) + 
+				              cy * (((sy + 0.5 + dy) * 0.5 + y) / h - 0.5) + gaze;
+			return CameraSample{ Ray(eye + d * 130.0, Normalize(d), EPSILON_SPHERE), 
+								 4u * ((h - 1u - y) * w + x) + subpixel };
+		};
+
+		Wavefront wavefront(capacity, sort_rays);
+		const std::size_t nb_paths = std::size_t(4u) * w * h * nb_samples;
+		const auto start = std::chrono::steady_clock::now();
+		const std::uint64_t nb_rays = wavefront.Trace(g_scene, nb_paths, generate, Ls_sums.get(), 
+													  g_default_seed, parallel_for);
+		const double time = std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+		fprintf(stderr, "Wavefront: %zu paths in flight%s, %llu rays in %.3fs (%.2f Mrays/s)\n", 
+				capacity, sort_rays ? " (sorted rays)" : "", 
+				static_cast< unsigned long long >(nb_rays), time, 1e-6 * nb_rays / time);
+
+		const std::vector< Tile > tiles = { Tile{ 0u, 0u, w, h } };
+		const std::vector< std::uint32_t > tile_nb_samples = { nb_samples };
+		ResolveTiles(tiles, tile_nb_samples, w, h, Ls_sums.get(), Ls.get());
 		WritePPM(w, h, Ls.get());
 	}
+
+	static CancellationToken g_cancellation_token;
+
+	static void CancelRender(int) noexcept {
+		g_cancellation_token.Cancel();
+	}
+
+	// A count written in decimal; nothing otherwise.
+	[[nodiscard]]
+	static std::optional< std::size_t > ParseCount(const char* str) noexcept {
+		if (!std::isdigit(static_cast< unsigned char >(*str))) {
+			return {};
+		}
+
+		char* end = nullptr;
+		const unsigned long long count = std::strtoull(str, &end, 10);
+		if ('\0' != *end) {
+			return {};
+		}
+		return static_cast< std::size_t >(count);
+	}
 }
 
 int main(int argc, char* argv[]) {
-	const std::uint32_t nb_samples = (2 == argc) ? atoi(argv[1]) / 4 : 1;
-	smallpt::Render(nb_samples);
+	const std::uint32_t nb_samples = (2 <= argc) ? atoi(argv[1]) / 4 : 1;
+
+	// The tile size and order are optional: the keywords below may follow 
+	// the spp or the tile size instead.
+	int first_keyword = 2;
+	std::uint32_t tile_size = smallpt::g_default_tile_size;
+	if (first_keyword < argc) {
+		if (const std::optional< std::uint32_t > size = smallpt::ParseTileSize(argv[first_keyword]); size) {
+			tile_size = *size;
+			++first_keyword;
+		}
+		else if (std::isdigit(static_cast< unsigned char >(*argv[first_keyword]))) {
+			std::fprintf(stderr, "Invalid tile size %s (1 to %u pixels)\n", 
+						 argv[first_keyword], smallpt::g_max_tile_size);
+			return 1;
+		}
+	}
+	smallpt::TileOrder tile_order = smallpt::TileOrder::Hilbert;
+	if (first_keyword < argc) {
+		if (const std::optional< smallpt::TileOrder > order = smallpt::ParseTileOrder(argv[first_keyword]); order) {
+			tile_order = *order;
+			++first_keyword;
+		}
+	}
+
+	// Remaining arguments: "progressive", "precision", "sphere_walls", 
+	// "static_scene", "wavefront[=<capacity>]", "sort_rays", "nee", "mis" or
+	// "mis_balance" (see LightSampling_t), "tile_costs" (report the cost of
+	// every tile), "pixel_stats" (report the samples and relative error of 
+	// every pixel), "adaptive[=<max relative error>]" (see 
+	// UpdateActiveTiles), "particles=<count>" and "frames=<count>".
+	bool progressive  = false;
+	bool precision    = false;
+	bool sphere_walls = false;
+	bool static_scene = false;
+	bool sort_rays    = false;
+	bool tile_costs   = false;
+	bool pixel_stats  = false;
+	std::size_t nb_particles = 0u;
+	std::size_t nb_frames    = 0u;
+	std::size_t wavefront_capacity = 0u;
+	double max_relative_error      = 0.0;
+	for (int i = first_keyword; i < argc; ++i) {
+		if (0 == std::strcmp(argv[i], "progressive")) {
+			progressive = true;
+		}
+		else if (0 == std::strcmp(argv[i], "precision")) {
+			precision = true;
+		}
+		else if (0 == std::strcmp(argv[i], "sphere_walls")) {
+			sphere_walls = true;
+		}
+		else if (0 == std::strcmp(argv[i], "static_scene")) {
+			static_scene = true;
+		}
+		else if (0 == std::strcmp(argv[i], "sort_rays")) {
+			sort_rays = true;
+		}
+		else if (0 == std::strcmp(argv[i], "tile_costs")) {
+			tile_costs = true;
+		}
+		else if (0 == std::strcmp(argv[i], "pixel_stats")) {
+			pixel_stats = true;
+		}
+		else if (0 == std::strcmp(argv[i], "adaptive")) {
+			max_relative_error = smallpt::g_default_max_relative_error;
+		}
+		else if (0 == std::strncmp(argv[i], "adaptive=", 9)) {
+			char* end = nullptr;
+			max_relative_error = std::strtod(argv[i] + 9, &end);
+			if (argv[i] + 9 == end || '\0' != *end || !(0.0 < max_relative_error)) {
+				std::fprintf(stderr, "Invalid maximum relative error %s\n", argv[i] + 9);
+				return 1;
+			}
+		}
+		else if (const smallpt::LightSampling_t light_sampling = smallpt::ParseLightSampling(argv[i]); 
+				 smallpt::LightSampling_t::None != light_sampling) {
+			smallpt::g_light_sampling = light_sampling;
+		}
+		else if (0 == std::strncmp(argv[i], "particles=", 10)) {
+			const std::optional< std::size_t > count = smallpt::ParseCount(argv[i] + 10);
+			if (!count) {
+				std::fprintf(stderr, "Invalid particle count %s\n", argv[i] + 10);
+				return 1;
+			}
+			nb_particles = *count;
+		}
+		else if (0 == std::strncmp(argv[i], "frames=", 7)) {
+			const std::optional< std::size_t > count = smallpt::ParseCount(argv[i] + 7);
+			if (!count) {
+				std::fprintf(stderr, "Invalid frame count %s\n", argv[i] + 7);
+				return 1;
+			}
+			nb_frames = *count;
+		}
+		else if (0 == std::strcmp(argv[i], "wavefront")) {
+			wavefront_capacity = smallpt::Wavefront::g_default_capacity;
+		}
+		else if (0 == std::strncmp(argv[i], "wavefront=", 10)) {
+			const std::optional< std::size_t > capacity = smallpt::ParseCount(argv[i] + 10);
+			if (!capacity || 0u == *capacity) {
+				std::fprintf(stderr, "Invalid wavefront capacity %s\n", argv[i] + 10);
+				return 1;
+			}
+			wavefront_capacity = *capacity;
+		}
+		else {
+			std::fprintf(stderr, "Unknown argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	// Only Radiance samples the lights, and only Render renders progressively
+	// or adaptively or gathers pixel statistics: reject the keywords the 
+	// other paths would ignore.
+	const bool static_scene_packets = static_scene && 0u == nb_particles;
+	if (smallpt::LightSampling_t::None != smallpt::g_light_sampling 
+		&& (static_scene_packets || 0u < wavefront_capacity)) {
+		std::fprintf(stderr, "nee, mis and mis_balance are not supported with static_scene or wavefront\n");
+		return 1;
+	}
+	if ((progressive || 0.0 < max_relative_error || pixel_stats) && 0u < wavefront_capacity) {
+		std::fprintf(stderr, "progressive, adaptive and pixel_stats are not supported with wavefront\n");
+		return 1;
+	}
+
+	// Compare single and double precision on the Cornell box (at a quarter
+	// of the resolution), instead of rendering.
+	if (precision) {
+		const smallpt::PrecisionComparison comparison 
+			= smallpt::ComparePrecision(smallpt::g_spheres, 256u, 192u, nb_samples);
+		std::fprintf(stderr, "Precision: float %.3fs, double %.3fs (float speedup x%.2f)\n", 
+					 comparison.m_float_time, comparison.m_double_time, 
+					 comparison.m_double_time / comparison.m_float_time);
+		std::fprintf(stderr, "Float vs double image: RMSE %.5f, mean error %+.5f, max error %.4f (noise RMSE %.5f)\n", 
+					 comparison.m_rmse, comparison.m_mean_error, comparison.m_max_error, comparison.m_noise_rmse);
+		return 0;
+	}
+
+	// The walls are planes, unless the original 1e5-radius spheres are asked
+	// for (to compare both).
+	const std::span< const smallpt::Sphere > objects 
+		= sphere_walls ? std::span< const smallpt::Sphere >(smallpt::g_spheres) : smallpt::g_objects;
+	const std::span< const smallpt::Plane > walls 
+		= sphere_walls ? std::span< const smallpt::Plane >() : std::span< const smallpt::Plane >(smallpt::g_walls);
+	if (sphere_walls) {
+		smallpt::g_scene = smallpt::Scene(objects, walls);
+	}
+
+	if (0u < nb_particles) {
+		std::vector< smallpt::Sphere > spheres(objects.begin(), objects.end());
+		smallpt::AddParticles(spheres, nb_particles);
+
+		const auto build_start = std::chrono::steady_clock::now();
+		smallpt::g_scene = smallpt::Scene(spheres, walls);
+		const double build_time = std::chrono::duration< double >(std::chrono::steady_clock::now() - build_start).count();
+		std::fprintf(stderr, "BVH build: %zu primitives in %.3fs (%.2f Mprimitives/s)\n", 
+					 spheres.size(), build_time, 1e-6 * spheres.size() / build_time);
+
+		// Advance the particles by nb_frames frames, updating the BVH (rather
+		// than building it anew) every frame, and render the last frame.
+		smallpt::ParticleAnimation animation(objects.size(), nb_particles);
+		for (std::size_t frame = 1u; frame <= nb_frames; ++frame) {
+			animation.Step(spheres);
+
+			const auto update_start = std::chrono::steady_clock::now();
+			const smallpt::BVHUpdate update = smallpt::g_scene.Update(spheres);
+			const double update_time = std::chrono::duration< double >(std::chrono::steady_clock::now() - update_start).count();
+			std::fprintf(stderr, "Frame %zu: BVH %s in %.3fs (SAH cost x%.2f, %zu subtrees rebuilt)\n", 
+						 frame, smallpt::ToString(update.m_type), update_time, 
+						 update.m_cost_ratio, update.m_nb_rebuilt_subtrees);
+		}
+	}
+
+	// Render the Cornell box compiled into the binary (see StaticScene)
+	// instead, unless particles were added.
+	if (static_scene_packets) {
+		smallpt::g_trace_packet = sphere_walls 
+			? &smallpt::TraceStaticPacket< smallpt::StaticSphereCornellBox > 
+			: &smallpt::TraceStaticPacket< smallpt::StaticCornellBox >;
+		std::fprintf(stderr, "Rendering the scene compiled into the binary\n");
+	}
+
+	// Trace the paths stage by stage instead (see Wavefront), sorting the
+	// rays before every bounce if asked to.
+	if (0u < wavefront_capacity) {
+		smallpt::RenderWavefront(nb_samples, wavefront_capacity, sort_rays);
+		return 0;
+	}
+
+	// Interim frames overwrite the output image after every pass, and Ctrl+C
+	// stops the render after the current tile, keeping the samples so far.
+	smallpt::PassCallback on_pass;
+	if (progressive) {
+		on_pass = [](std::uint32_t pass, std::uint32_t nb_samples, 
+					 std::uint32_t w, std::uint32_t h, const smallpt::Vector3* Ls) {
+			std::fprintf(stderr, "\nPass %u: %u spp\n", pass, nb_samples * 4);
+			smallpt::WritePPM(w, h, Ls);
+		};
+	}
+	std::signal(SIGINT, smallpt::CancelRender);
+
+	const auto render_start = std::chrono::steady_clock::now();
+	smallpt::Render(nb_samples, tile_size, tile_order, progressive, pixel_stats, 
+					max_relative_error, tile_costs, smallpt::g_cancellation_token, on_pass);
+	const double render_time = std::chrono::duration< double >(std::chrono::steady_clock::now() - render_start).count();
+	std::fprintf(stderr, "Render time: %.3fs\n", render_time);
 
 	return 0;
 }
@@ -0,0 +1,84 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "sphere.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Plane
+	//-------------------------------------------------------------------------
+
+	// An infinite plane of the scalar type T (float or double): the points p
+	// with n . p = d, for the unit normal n.
+	template< typename T >
+	struct BasicPlane {
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		constexpr explicit BasicPlane(BasicVector3< T > n,
+									  T d,
+									  BasicVector3< T > e,
+									  BasicVector3< T > f,
+									  Reflection_t reflection_t) noexcept
+			: m_n(std::move(n)),
+			m_d(d),
+			m_e(std::move(e)),
+			m_f(std::move(f)),
+			m_reflection_t(reflection_t) {}
+		constexpr BasicPlane(const BasicPlane& plane) noexcept = default;
+		constexpr BasicPlane(BasicPlane&& plane) noexcept = default;
+		~BasicPlane() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		BasicPlane& operator=(const BasicPlane& plane) = default;
+		BasicPlane& operator=(BasicPlane&& plane) = default;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		[[nodiscard]]
+		constexpr bool Intersect(const BasicRay< T >& ray) const noexcept {
+			// n . (o + t*d) = d
+			// <=> t = (d - n . o) / (n . d)
+			//
+			// Rays parallel to the plane yield an infinite (or NaN) distance,
+			// which fails the range check.
+			const T t = (m_d - m_n.Dot(ray.m_o)) / m_n.Dot(ray.m_d);
+			if (ray.m_tmin < t && t < ray.m_tmax) {
+				ray.m_tmax = t;
+				return true;
+			}
+
+			return false;
+		}
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		BasicVector3< T > m_n; // normal
+		T m_d;                 // offset along the normal
+		BasicVector3< T > m_e; // emission
+		BasicVector3< T > m_f; // reflection
+		Reflection_t m_reflection_t;
+	};
+
+	using Plane  = BasicPlane< double >;
+	using Planef = BasicPlane< float >;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "tile.hpp"
+#include "vector.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: CancellationToken
+	//-------------------------------------------------------------------------
+
+	class CancellationToken {
+
+	public:
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		CancellationToken() noexcept
+			: m_cancelled(false) {}
+		CancellationToken(const CancellationToken& token) = delete;
+		CancellationToken(CancellationToken&& token) = delete;
+		~CancellationToken() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		CancellationToken& operator=(const CancellationToken& token) = delete;
+		CancellationToken& operator=(CancellationToken&& token) = delete;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		// May be called from any thread (or a signal handler).
+		void Cancel() noexcept {
+			m_cancelled.store(true, std::memory_order_relaxed);
+		}
+
+		[[nodiscard]]
+		bool IsCancelled() const noexcept {
+			return m_cancelled.load(std::memory_order_relaxed);
+		}
+
+	private:
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		std::atomic< bool > m_cancelled;
+	};
+
+	//-------------------------------------------------------------------------
+	// Progressive Rendering
+	//-------------------------------------------------------------------------
+
+	// Called after every pass with the index of the pass, the number of
+	// samples per subpixel rendered so far and the resolved image.
+	using PassCallback = std::function< void(std::uint32_t pass,
+											 std::uint32_t nb_samples,
+											 std::uint32_t w,
+											 std::uint32_t h,
+											 const Vector3* Ls) >;
+
+	// The number of samples per subpixel of the next pass: 1, 1, 2, 4, ...,
+	// so the total doubles every pass (1, 2, 4, 8, ...) up to nb_samples.
+	[[nodiscard]]
+	constexpr std::uint32_t NextPassSamples(std::uint32_t nb_samples_done,
+											std::uint32_t nb_samples) noexcept {
+		const std::uint32_t nb_samples_left = nb_samples - nb_samples_done;
+		return std::min(std::max(1u, nb_samples_done), nb_samples_left);
+	}
+
+	// Resolves the radiance sums of the 2x2 subpixels of a pixel.
+	[[nodiscard]]
+	inline const Vector3 ResolvePixel(const Vector3* subpixel_sums,
+									  std::uint32_t nb_samples) noexcept {
+		if (0u == nb_samples) {
+			return Vector3();
+		}
+
+		const double inv_nb_samples = 1.0 / nb_samples;
+		Vector3 L;
+		for (std::size_t k = 0u; k < 4u; ++k) { // subpixel
+			L += 0.25 * Clamp(subpixel_sums[k] * inv_nb_samples);
+		}
+		return L;
+	}
+
+	// Resolves the subpixel radiance sums of every tile into Ls, given the
+	// number of samples per subpixel each tile has accumulated so far (tiles
+	// may differ if a pass was cancelled halfway).
+	inline void ResolveTiles(const std::vector< Tile >& tiles, 
+							 const std::vector< std::uint32_t >& tile_nb_samples, 
+							 std::uint32_t w, 
+							 std::uint32_t h, 
+							 const Vector3* Ls_sums, 
+							 Vector3* Ls) noexcept {
+
+		for (std::size_t t = 0u; t < tiles.size(); ++t) { // tile
+			const Tile& tile = tiles[t];
+			for (std::size_t y = tile.m_y0; y < tile.m_y1; ++y) { // pixel row
+				for (std::size_t x = tile.m_x0; x < tile.m_x1; ++x) { // pixel column
+					const std::size_t i = (h - 1u - y) * w + x;
+					Ls[i] = ResolvePixel(&Ls_sums[4u * i], tile_nb_samples[t]);
+				}
+			}
+		}
+	}
+}
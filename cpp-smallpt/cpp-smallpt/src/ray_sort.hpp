@@ -0,0 +1,134 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "bvh.hpp"
+#include "geometry.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Radix Sort
+	//-------------------------------------------------------------------------
+
+	// Sorts the values by their keys (stably), of which only the lowest
+	// nb_key_bits bits are set, one 8-bit digit at a time from the least
+	// significant one on. Every pass runs in chunks with parallel_for (see
+	// SerialFor): each chunk counts its digits, and then scatters its pairs
+	// to the offsets a prefix sum over the counts of all chunks gives it.
+	// Passes over a digit all keys share are skipped.
+	template< typename ParallelForT = SerialFor >
+	void RadixSort(std::vector< std::uint32_t >& keys,
+				   std::vector< std::uint32_t >& values,
+				   std::uint32_t nb_key_bits = 32u,
+				   const ParallelForT& parallel_for = {}) {
+
+		static constexpr std::size_t chunk_size = 1024u;
+		static constexpr std::size_t nb_buckets = 256u;
+
+		const std::size_t n         = keys.size();
+		const std::size_t nb_chunks = (n + chunk_size - 1u) / chunk_size;
+		std::vector< std::uint32_t > sorted_keys(n);
+		std::vector< std::uint32_t > sorted_values(n);
+		std::vector< std::size_t > offsets(nb_chunks * nb_buckets);
+
+		for (std::uint32_t shift = 0u; shift < nb_key_bits; shift += 8u) {
+			parallel_for(nb_chunks, [&keys, &offsets, n, shift](std::size_t chunk) noexcept {
+				std::size_t* const counts = &offsets[chunk * nb_buckets];
+				std::fill(counts, counts + nb_buckets, std::size_t(0u));
+				const std::size_t end = std::min(n, (chunk + 1u) * chunk_size);
+				for (std::size_t i = chunk * chunk_size; i < end; ++i) {
+					++counts[(keys[i] >> shift) & 0xFFu];
+				}
+			});
+
+			// The offsets of every digit, chunk after chunk.
+			std::size_t offset = 0u;
+			bool shared_digit  = false;
+			for (std::size_t digit = 0u; digit < nb_buckets; ++digit) {
+				const std::size_t digit_begin = offset;
+				for (std::size_t chunk = 0u; chunk < nb_chunks; ++chunk) {
+					const std::size_t count = offsets[chunk * nb_buckets + digit];
+					offsets[chunk * nb_buckets + digit] = offset;
+					offset += count;
+				}
+				shared_digit |= (n == offset - digit_begin);
+			}
+			if (shared_digit) {
+				continue;
+			}
+
+			parallel_for(nb_chunks, [&keys, &values, &sorted_keys, &sorted_values, &offsets, n, shift](std::size_t chunk) noexcept {
+				std::size_t* const chunk_offsets = &offsets[chunk * nb_buckets];
+				const std::size_t end = std::min(n, (chunk + 1u) * chunk_size);
+				for (std::size_t i = chunk * chunk_size; i < end; ++i) {
+					const std::size_t j = chunk_offsets[(keys[i] >> shift) & 0xFFu]++;
+					sorted_keys[j]   = keys[i];
+					sorted_values[j] = values[i];
+				}
+			});
+			keys.swap(sorted_keys);
+			values.swap(sorted_values);
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Ray Keys
+	//-------------------------------------------------------------------------
+
+	// Inserts two zero bits above each of the lowest 10 bits of v.
+	[[nodiscard]]
+	constexpr std::uint32_t SpreadBits3(std::uint32_t v) noexcept {
+		v &= 0x000003FFu;
+		v = (v | (v << 16u)) & 0x030000FFu;
+		v = (v | (v << 8u))  & 0x0300F00Fu;
+		v = (v | (v << 4u))  & 0x030C30C3u;
+		v = (v | (v << 2u))  & 0x09249249u;
+		return v;
+	}
+
+	[[nodiscard]]
+	constexpr std::uint32_t MortonCode3(std::uint32_t x, std::uint32_t y, std::uint32_t z) noexcept {
+		return SpreadBits3(x) | (SpreadBits3(y) << 1u) | (SpreadBits3(z) << 2u);
+	}
+
+	// The number of bits of a RayKey.
+	constexpr std::uint32_t g_ray_key_bits = 30u;
+
+	// A key grouping rays of similar origin and direction: the octant of the
+	// direction (the sign of each component), above the 27-bit Morton code of
+	// the origin quantized to a 512^3 grid over the given bounds.
+	[[nodiscard]]
+	inline std::uint32_t RayKey(const Ray& ray,
+								const Vector3& origin_min,
+								const Vector3& origin_scale) noexcept {
+		const std::uint32_t octant = (0.0 > ray.m_d.m_x ? 1u : 0u)
+								   | (0.0 > ray.m_d.m_y ? 2u : 0u)
+								   | (0.0 > ray.m_d.m_z ? 4u : 0u);
+		const Vector3 q = (ray.m_o - origin_min) * origin_scale;
+		const auto quantize = [](double x) noexcept {
+			return static_cast< std::uint32_t >(std::clamp(x, 0.0, 511.0));
+		};
+		return (octant << 27u) | MortonCode3(quantize(q.m_x), quantize(q.m_y), quantize(q.m_z));
+	}
+}
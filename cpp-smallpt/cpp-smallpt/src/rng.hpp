@@ -15,20 +15,109 @@
 //-----------------------------------------------------------------------------
 namespace smallpt {
 
-	class RNG {
+	constexpr std::uint32_t g_default_seed = 606418532u;
+
+	// Derives the initial state of an independent stream (e.g., one per pixel)
+	// from a base seed, regardless of the order in which the streams are 
+	// consumed. All 64 bits are kept: distinct (seed, stream) pairs (with 
+	// stream < 2^32) get distinct states.
+	[[nodiscard]]
+	constexpr std::uint64_t StreamSeed(std::uint32_t seed, 
+									   std::uint64_t stream) noexcept {
+		// SplitMix64 finalizer
+		std::uint64_t z = (static_cast< std::uint64_t >(seed) << 32u) ^ stream;
+		z += 0x9E3779B97F4A7C15ull;
+		z = (z ^ (z >> 30u)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27u)) * 0x94D049BB133111EBull;
+		z ^= (z >> 31u);
+		return z;
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: PCG32
+	//-------------------------------------------------------------------------
+
+	// PCG-XSH-RR (O'Neill): a 64-bit LCG state with a 32-bit permuted output.
+	// Every odd increment selects a different sequence of period 2^64, so 
+	// each stream gets its own instead of a window of a shared one.
+	class PCG32 {
 
 	public:
 
+		using result_type = std::uint32_t;
+
 		//---------------------------------------------------------------------
 		// Constructors and Destructors
 		//---------------------------------------------------------------------
 
-		explicit RNG(std::uint32_t seed = 606418532u) noexcept
-			: m_generator(),
-			m_distribution() {
+		constexpr PCG32(std::uint64_t state, std::uint64_t stream) noexcept
+			: m_state(0u),
+			m_increment((stream << 1u) | 1u) {
 
-			Seed(seed);
+			(*this)();
+			m_state += state;
+			(*this)();
 		}
+		constexpr PCG32(const PCG32& generator) noexcept = default;
+		constexpr PCG32(PCG32&& generator) noexcept = default;
+		~PCG32() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		constexpr PCG32& operator=(const PCG32& generator) noexcept = default;
+		constexpr PCG32& operator=(PCG32&& generator) noexcept = default;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		[[nodiscard]]
+		static constexpr result_type min() noexcept {
+			return 0u;
+		}
+
+		[[nodiscard]]
+		static constexpr result_type max() noexcept {
+			return 0xFFFFFFFFu;
+		}
+
+		constexpr result_type operator()() noexcept {
+			const std::uint64_t state = m_state;
+			m_state = state * 6364136223846793005ull + m_increment;
+			const auto xorshifted = static_cast< std::uint32_t >(((state >> 18u) ^ state) >> 27u);
+			const auto rotation   = static_cast< std::uint32_t >(state >> 59u);
+			return (xorshifted >> rotation) | (xorshifted << ((0u - rotation) & 31u));
+		}
+
+	private:
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		std::uint64_t m_state;
+		std::uint64_t m_increment; // odd
+	};
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: RNG
+	//-------------------------------------------------------------------------
+
+	class RNG {
+
+	public:
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		// The random numbers of the given stream of the given seed.
+		explicit RNG(std::uint32_t seed = g_default_seed, 
+					 std::uint64_t stream = 0u) noexcept
+			: m_generator(StreamSeed(seed, stream), stream),
+			m_distribution() {}
 		RNG(const RNG &rng) noexcept = default;
 		RNG(RNG &&rng) noexcept = default;
 		~RNG() = default;
@@ -44,10 +133,6 @@ namespace smallpt {
 		// Member Methods
 		//---------------------------------------------------------------------
 
-		void Seed(uint32_t seed) noexcept {
-			m_generator.seed(seed);
-		}
-
 		double Uniform() noexcept {
 			return m_distribution(m_generator);
 		}
@@ -58,7 +143,7 @@ namespace smallpt {
 		// Member Variables
 		//---------------------------------------------------------------------
 
-		std::default_random_engine m_generator;
+		PCG32 m_generator;
 		std::uniform_real_distribution< double > m_distribution;
 	};
 }
\ No newline at end of file
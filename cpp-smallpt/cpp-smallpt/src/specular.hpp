@@ -15,58 +15,66 @@
 //-----------------------------------------------------------------------------
 namespace smallpt {
 
+	// The refractive indices outside (air) and inside the refractive spheres.
+	constexpr double g_refractive_index_out = 1.0;
+	constexpr double g_refractive_index_in  = 1.5;
+
+	template< typename T >
 	[[nodiscard]]
-	constexpr double Reflectance0(double n1, double n2) noexcept {
-		const double sqrt_R0 = (n1 - n2) / (n1 + n2);
+	constexpr T Reflectance0(T n1, T n2) noexcept {
+		const T sqrt_R0 = (n1 - n2) / (n1 + n2);
 		return sqrt_R0 * sqrt_R0;
 	}
 
+	template< typename T >
 	[[nodiscard]]
-	constexpr double SchlickReflectance(double n1, double n2, double c) noexcept {
-		const double R0 = Reflectance0(n1, n2);
-		return R0 + (1.0 - R0) * c * c * c * c * c;
+	constexpr T SchlickReflectance(T n1, T n2, T c) noexcept {
+		const T R0 = Reflectance0(n1, n2);
+		return R0 + (T(1) - R0) * c * c * c * c * c;
 	}
 
+	template< typename T >
 	[[nodiscard]]
-	constexpr const Vector3 IdealSpecularReflect(const Vector3& d, 
-												 const Vector3& n) noexcept {
-		return d - 2.0 * n.Dot(d) * n;
+	constexpr const BasicVector3< T > IdealSpecularReflect(const BasicVector3< T >& d, 
+														   const BasicVector3< T >& n) noexcept {
+		return d - T(2) * n.Dot(d) * n;
 	}
 
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 IdealSpecularTransmit(const Vector3& d, 
-											   const Vector3& n, 
-											   double n_out, 
-											   double n_in, 
-											   double& pr, 
-											   RNG& rng) noexcept {
+	inline const BasicVector3< T > IdealSpecularTransmit(const BasicVector3< T >& d, 
+														 const BasicVector3< T >& n, 
+														 std::type_identity_t< T > n_out, 
+														 std::type_identity_t< T > n_in, 
+														 T& pr, 
+														 RNG& rng) noexcept {
 		
-		const Vector3 d_Re = IdealSpecularReflect(d, n);
+		const BasicVector3< T > d_Re = IdealSpecularReflect(d, n);
 
-		const bool out_to_in = (0.0 > n.Dot(d));
-		const Vector3 nl = out_to_in ? n : -n;
-		const double nn = out_to_in ? n_out / n_in : n_in / n_out;
-		const double cos_theta = d.Dot(nl);
-		const double cos2_phi = 1.0 - nn * nn * (1.0 - cos_theta * cos_theta);
+		const bool out_to_in = (T(0) > n.Dot(d));
+		const BasicVector3< T > nl = out_to_in ? n : -n;
+		const T nn = out_to_in ? n_out / n_in : n_in / n_out;
+		const T cos_theta = d.Dot(nl);
+		const T cos2_phi = T(1) - nn * nn * (T(1) - cos_theta * cos_theta);
 
 		// Total Internal Reflection
-		if (0.0 > cos2_phi) {
-			pr = 1.0;
+		if (T(0) > cos2_phi) {
+			pr = T(1);
 			return d_Re;
 		}
 
-		const Vector3 d_Tr = Normalize(nn * d - nl * (nn * cos_theta + sqrt(cos2_phi)));
-		const double c = 1.0 - (out_to_in ? -cos_theta : d_Tr.Dot(n));
+		const BasicVector3< T > d_Tr = Normalize(nn * d - nl * (nn * cos_theta + std::sqrt(cos2_phi)));
+		const T c = T(1) - (out_to_in ? -cos_theta : d_Tr.Dot(n));
 
-		const double Re = SchlickReflectance(n_out, n_in, c);
-		const double p_Re = 0.25 + 0.5 * Re;
+		const T Re = SchlickReflectance(n_out, n_in, c);
+		const T p_Re = T(0.25) + T(0.5) * Re;
 		if (rng.Uniform() < p_Re) {
 			pr = (Re / p_Re);
 			return d_Re;
 		}
 		else {
-			const double Tr = 1.0 - Re;
-			const double p_Tr = 1.0 - p_Re;
+			const T Tr = T(1) - Re;
+			const T p_Tr = T(1) - p_Re;
 			pr = (Tr / p_Tr);
 			return d_Tr;
 		}
@@ -0,0 +1,148 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "box.hpp"
+#include "plane.hpp"
+#include "scene.hpp"
+#include "sphere.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <utility>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: StaticScene
+	//-------------------------------------------------------------------------
+
+	inline constexpr std::span< const Plane > g_no_planes;
+	inline constexpr std::span< const Box > g_no_boxes;
+
+	// A scene fixed at compile time: Spheres, Planes and Boxes are constexpr
+	// arrays (or spans of them). Every query is unrolled over the primitives,
+	// so their centers, radii and normals are constants of the code, and
+	// Visit calls a shader instantiated for the constant material of the hit
+	// primitive. This suits a few primitives, for a binary built per scene;
+	// Scene handles any other. The primitives are indexed as in Scene.
+	template< const auto& Spheres,
+			  const auto& Planes = g_no_planes,
+			  const auto& Boxes = g_no_boxes >
+	class StaticScene {
+
+	public:
+
+		//---------------------------------------------------------------------
+		// Class Member Variables
+		//---------------------------------------------------------------------
+
+		static constexpr std::size_t g_nb_spheres    = std::size(Spheres);
+		static constexpr std::size_t g_nb_planes     = std::size(Planes);
+		static constexpr std::size_t g_nb_boxes      = std::size(Boxes);
+		static constexpr std::size_t g_nb_primitives = g_nb_spheres + g_nb_planes + g_nb_boxes;
+
+		//---------------------------------------------------------------------
+		// Class Member Methods
+		//---------------------------------------------------------------------
+
+		[[nodiscard]]
+		static std::optional< std::size_t > Intersect(const Ray& ray) noexcept {
+			std::size_t hit = g_nb_primitives;
+			[&ray, &hit]< std::size_t... I >(std::index_sequence< I... >) noexcept {
+				((IntersectPrimitive< I >(ray) ? void(hit = I) : void()), ...);
+			}(std::make_index_sequence< g_nb_primitives >());
+
+			if (g_nb_primitives != hit) {
+				return hit;
+			}
+			return {};
+		}
+
+		// See Scene::Occluded.
+		[[nodiscard]]
+		static bool Occluded(const Ray& ray, double tmax) noexcept {
+			const Ray segment(ray.m_o, ray.m_d, ray.m_tmin, tmax, ray.m_depth);
+			return [&segment]< std::size_t... I >(std::index_sequence< I... >) noexcept {
+				return (IntersectPrimitive< I >(segment) || ...);
+			}(std::make_index_sequence< g_nb_primitives >());
+		}
+
+		// Calls f.template operator()< I >() for the primitive I == i, e.g. a
+		// template lambda shading primitive I with GetMaterial< I >().
+		template< typename F >
+		static void Visit(std::size_t i, F&& f) {
+			[i, &f]< std::size_t... I >(std::index_sequence< I... >) {
+				(void)((I == i && (f.template operator()< I >(), true)) || ...);
+			}(std::make_index_sequence< g_nb_primitives >());
+		}
+
+		// See Scene::GetNormal.
+		template< std::size_t I >
+		[[nodiscard]]
+		static const Vector3 GetNormal([[maybe_unused]] const Vector3& p) noexcept {
+			if constexpr (I < g_nb_spheres) {
+				return Normalize(p - Spheres[I].m_p);
+			}
+			else if constexpr (I < g_nb_spheres + g_nb_planes) {
+				return Planes[I - g_nb_spheres].m_n;
+			}
+			else {
+				return Boxes[I - g_nb_spheres - g_nb_planes].GetNormal(p);
+			}
+		}
+
+		template< std::size_t I >
+		[[nodiscard]]
+		static constexpr Material GetMaterial() noexcept {
+			if constexpr (I < g_nb_spheres) {
+				return { Spheres[I].m_e, Spheres[I].m_f, Spheres[I].m_reflection_t };
+			}
+			else if constexpr (I < g_nb_spheres + g_nb_planes) {
+				return { Planes[I - g_nb_spheres].m_e, Planes[I - g_nb_spheres].m_f,
+						 Planes[I - g_nb_spheres].m_reflection_t };
+			}
+			else {
+				return { Boxes[I - g_nb_spheres - g_nb_planes].m_e, Boxes[I - g_nb_spheres - g_nb_planes].m_f,
+						 Boxes[I - g_nb_spheres - g_nb_planes].m_reflection_t };
+			}
+		}
+
+	private:
+
+		//---------------------------------------------------------------------
+		// Class Member Methods
+		//---------------------------------------------------------------------
+
+		template< std::size_t I >
+		[[nodiscard]]
+		static bool IntersectPrimitive(const Ray& ray) noexcept {
+			if constexpr (I < g_nb_spheres) {
+				return Spheres[I].Intersect(ray);
+			}
+			else if constexpr (I < g_nb_spheres + g_nb_planes) {
+				return Planes[I - g_nb_spheres].Intersect(ray);
+			}
+			else {
+				return Boxes[I - g_nb_spheres - g_nb_planes].Intersect(ray);
+			}
+		}
+	};
+}
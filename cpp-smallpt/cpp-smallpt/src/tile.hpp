@@ -0,0 +1,254 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: TileOrder
+	//-------------------------------------------------------------------------
+
+	enum struct TileOrder : std::uint8_t {
+		Scanline = 0u,
+		Morton,
+		Hilbert
+	};
+
+	// "scanline", "morton" or "hilbert"; nothing otherwise.
+	[[nodiscard]]
+	inline std::optional< TileOrder > ParseTileOrder(const char* str) noexcept {
+		if (0 == std::strcmp(str, "scanline")) {
+			return TileOrder::Scanline;
+		}
+		if (0 == std::strcmp(str, "morton")) {
+			return TileOrder::Morton;
+		}
+		if (0 == std::strcmp(str, "hilbert")) {
+			return TileOrder::Hilbert;
+		}
+		return {};
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Tile Size
+	//-------------------------------------------------------------------------
+
+	constexpr std::uint32_t g_default_tile_size = 32u;
+	constexpr std::uint32_t g_max_tile_size     = 1u << 16u;
+
+	// A tile size between 1 and g_max_tile_size pixels, written in decimal;
+	// nothing otherwise (e.g., for a keyword).
+	[[nodiscard]]
+	inline std::optional< std::uint32_t > ParseTileSize(const char* str) noexcept {
+		if (!std::isdigit(static_cast< unsigned char >(*str))) {
+			return {};
+		}
+
+		char* end = nullptr;
+		const unsigned long long tile_size = std::strtoull(str, &end, 10);
+		if ('\0' != *end || 0ull == tile_size || g_max_tile_size < tile_size) {
+			return {};
+		}
+		return static_cast< std::uint32_t >(tile_size);
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Tile
+	//-------------------------------------------------------------------------
+
+	struct Tile {
+		std::uint32_t m_x0, m_y0; // inclusive
+		std::uint32_t m_x1, m_y1; // exclusive
+	};
+
+	//-------------------------------------------------------------------------
+	// Space-filling Curves
+	//-------------------------------------------------------------------------
+
+	[[nodiscard]]
+	constexpr std::uint32_t SpreadBits(std::uint32_t v) noexcept {
+		v &= 0x0000FFFFu;
+		v = (v | (v << 8u)) & 0x00FF00FFu;
+		v = (v | (v << 4u)) & 0x0F0F0F0Fu;
+		v = (v | (v << 2u)) & 0x33333333u;
+		v = (v | (v << 1u)) & 0x55555555u;
+		return v;
+	}
+
+	[[nodiscard]]
+	constexpr std::uint32_t MortonCode(std::uint32_t x, std::uint32_t y) noexcept {
+		return SpreadBits(x) | (SpreadBits(y) << 1u);
+	}
+
+	// n: the side of the (power-of-two) grid containing (x, y).
+	[[nodiscard]]
+	constexpr std::uint64_t HilbertCode(std::uint32_t n,
+										std::uint32_t x,
+										std::uint32_t y) noexcept {
+		std::uint64_t d = 0u;
+		for (std::uint32_t s = n / 2u; 0u < s; s /= 2u) {
+			const std::uint32_t rx = (0u < (x & s)) ? 1u : 0u;
+			const std::uint32_t ry = (0u < (y & s)) ? 1u : 0u;
+			d += static_cast< std::uint64_t >(s) * s * ((3u * rx) ^ ry);
+
+			// Rotate the quadrant.
+			if (0u == ry) {
+				if (1u == rx) {
+					x = s - 1u - x;
+					y = s - 1u - y;
+				}
+				std::swap(x, y);
+			}
+		}
+		return d;
+	}
+
+	//-------------------------------------------------------------------------
+	// Tile Generation
+	//-------------------------------------------------------------------------
+
+	[[nodiscard]]
+	inline std::vector< Tile > GenerateTiles(std::uint32_t w,
+											 std::uint32_t h,
+											 std::uint32_t tile_size,
+											 TileOrder order) {
+
+		tile_size = std::max(1u, tile_size);
+		const std::uint32_t nb_tiles_x = (w + tile_size - 1u) / tile_size;
+		const std::uint32_t nb_tiles_y = (h + tile_size - 1u) / tile_size;
+
+		std::uint32_t n = 1u;
+		while (n < nb_tiles_x || n < nb_tiles_y) {
+			n *= 2u;
+		}
+
+		std::vector< std::pair< std::uint64_t, Tile > > keyed_tiles;
+		keyed_tiles.reserve(nb_tiles_x * nb_tiles_y);
+		for (std::uint32_t ty = 0u; ty < nb_tiles_y; ++ty) {
+			for (std::uint32_t tx = 0u; tx < nb_tiles_x; ++tx) {
+
+				std::uint64_t key = 0u;
+				switch (order) {
+				case TileOrder::Morton:
+					key = MortonCode(tx, ty);
+					break;
+				case TileOrder::Hilbert:
+					key = HilbertCode(n, tx, ty);
+					break;
+				default:
+					key = static_cast< std::uint64_t >(ty) * nb_tiles_x + tx;
+					break;
+				}
+
+				const Tile tile = {
+					tx * tile_size,
+					ty * tile_size,
+					std::min(w, (tx + 1u) * tile_size),
+					std::min(h, (ty + 1u) * tile_size)
+				};
+				keyed_tiles.emplace_back(key, tile);
+			}
+		}
+
+		std::sort(keyed_tiles.begin(), keyed_tiles.end(),
+				  [](const auto& lhs, const auto& rhs) noexcept {
+					  return lhs.first < rhs.first;
+				  });
+
+		std::vector< Tile > tiles;
+		tiles.reserve(keyed_tiles.size());
+		for (const auto& keyed_tile : keyed_tiles) {
+			tiles.push_back(keyed_tile.second);
+		}
+
+		return tiles;
+	}
+
+	//-------------------------------------------------------------------------
+	// Cost-based Partitioning
+	//-------------------------------------------------------------------------
+
+	// Splits the tiles into nb_chunks contiguous chunks of (approximately)
+	// equal total cost. Chunk k consists of the tiles [bounds[k], bounds[k+1]).
+	[[nodiscard]]
+	inline std::vector< std::size_t > PartitionByCost(const std::vector< double >& costs, 
+													  std::size_t nb_chunks) {
+		
+		double total_cost = 0.0;
+		for (const double cost : costs) {
+			total_cost += cost;
+		}
+
+		std::vector< std::size_t > bounds(nb_chunks + 1u, costs.size());
+		bounds[0] = 0u;
+
+		double prefix_cost = 0.0;
+		std::size_t i = 0u;
+		for (std::size_t k = 1u; k < nb_chunks; ++k) {
+			const double target_cost = total_cost * k / nb_chunks;
+			while (i < costs.size() && prefix_cost + 0.5 * costs[i] < target_cost) {
+				prefix_cost += costs[i];
+				++i;
+			}
+			bounds[k] = i;
+		}
+
+		return bounds;
+	}
+
+	//-------------------------------------------------------------------------
+	// Tile Statistics
+	//-------------------------------------------------------------------------
+
+	inline void PrintTileCosts(const std::vector< double >& costs) noexcept {
+		if (costs.empty()) {
+			return;
+		}
+
+		const auto [min_cost, max_cost] = std::minmax_element(costs.cbegin(), costs.cend());
+		double total_cost = 0.0;
+		for (const double cost : costs) {
+			total_cost += cost;
+		}
+		const double mean_cost = total_cost / costs.size();
+
+		std::fprintf(stderr, "Tiles: %zu, cost min %.4fs, mean %.4fs, max %.4fs (max/mean %.2f)\n", 
+					 costs.size(), *min_cost, mean_cost, *max_cost, 
+					 (0.0 < mean_cost) ? *max_cost / mean_cost : 0.0);
+	}
+
+	inline void PrintLoadImbalance(const std::vector< double >& busy_times) noexcept {
+		if (busy_times.empty()) {
+			return;
+		}
+
+		const double max_busy_time = *std::max_element(busy_times.cbegin(), busy_times.cend());
+		double total_busy_time = 0.0;
+		for (const double busy_time : busy_times) {
+			total_busy_time += busy_time;
+		}
+		const double mean_busy_time = total_busy_time / busy_times.size();
+
+		std::fprintf(stderr, "Threads: %zu, busy time mean %.3fs, max %.3fs (load imbalance max/mean %.3f)\n", 
+					 busy_times.size(), mean_busy_time, max_busy_time, 
+					 (0.0 < mean_busy_time) ? max_busy_time / mean_busy_time : 0.0);
+	}
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "sphere.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Box
+	//-------------------------------------------------------------------------
+
+	// A solid axis-aligned box of the scalar type T (float or double).
+	template< typename T >
+	struct BasicBox {
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		constexpr explicit BasicBox(BasicVector3< T > min,
+									BasicVector3< T > max,
+									BasicVector3< T > e,
+									BasicVector3< T > f,
+									Reflection_t reflection_t) noexcept
+			: m_min(std::move(min)),
+			m_max(std::move(max)),
+			m_e(std::move(e)),
+			m_f(std::move(f)),
+			m_reflection_t(reflection_t) {}
+		constexpr BasicBox(const BasicBox& box) noexcept = default;
+		constexpr BasicBox(BasicBox&& box) noexcept = default;
+		~BasicBox() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		BasicBox& operator=(const BasicBox& box) = default;
+		BasicBox& operator=(BasicBox&& box) = default;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		[[nodiscard]]
+		bool Intersect(const BasicRay< T >& ray) const noexcept {
+			// The ray is inside the slab of every axis over [t_entry, t_exit].
+			// A zero direction component yields infinite slab distances (or
+			// NaN for an origin on a face, which std::max and std::min drop
+			// as their second operand).
+			T t_entry = -std::numeric_limits< T >::infinity();
+			T t_exit  =  std::numeric_limits< T >::infinity();
+			for (std::size_t a = 0u; a < 3u; ++a) {
+				const T inv_d = T(1) / ray.m_d[a];
+				const T t0 = (m_min[a] - ray.m_o[a]) * inv_d;
+				const T t1 = (m_max[a] - ray.m_o[a]) * inv_d;
+				t_entry = std::max(t_entry, std::min(t0, t1));
+				t_exit  = std::min(t_exit, std::max(t0, t1));
+			}
+
+			if (t_entry > t_exit) {
+				return false;
+			}
+
+			// Outside the box, the ray hits its entry face; inside, its exit face.
+			if (ray.m_tmin < t_entry && t_entry < ray.m_tmax) {
+				ray.m_tmax = t_entry;
+				return true;
+			}
+
+			if (ray.m_tmin < t_exit && t_exit < ray.m_tmax) {
+				ray.m_tmax = t_exit;
+				return true;
+			}
+
+			return false;
+		}
+
+		// The outward normal of the face closest to the given surface point.
+		[[nodiscard]]
+		const BasicVector3< T > GetNormal(const BasicVector3< T >& p) const noexcept {
+			BasicVector3< T > n;
+			T min_distance = std::numeric_limits< T >::infinity();
+			for (std::size_t a = 0u; a < 3u; ++a) {
+				const T distance_min = std::abs(p[a] - m_min[a]);
+				const T distance_max = std::abs(m_max[a] - p[a]);
+				if (distance_min < min_distance) {
+					min_distance = distance_min;
+					n = BasicVector3< T >();
+					n[a] = T(-1);
+				}
+				if (distance_max < min_distance) {
+					min_distance = distance_max;
+					n = BasicVector3< T >();
+					n[a] = T(1);
+				}
+			}
+			return n;
+		}
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		BasicVector3< T > m_min;
+		BasicVector3< T > m_max;
+		BasicVector3< T > m_e; // emission
+		BasicVector3< T > m_f; // reflection
+		Reflection_t m_reflection_t;
+	};
+
+	using Box  = BasicBox< double >;
+	using Boxf = BasicBox< float >;
+}
@@ -5,6 +5,7 @@
 //-----------------------------------------------------------------------------
 #pragma region
 
+#include "tile.hpp"
 #include "vector.hpp"
 
 #pragma endregion
@@ -14,7 +15,9 @@
 //-----------------------------------------------------------------------------
 #pragma region
 
+#include <algorithm>
 #include <cstdio>
+#include <vector>
 
 #pragma endregion
 
@@ -42,4 +45,45 @@ namespace smallpt {
 		
 		std::fclose(fp);
 	}
-}
+
+	// Writes the number of samples of every pixel as a grey-scale image, in
+	// which white is the largest number.
+	inline void WriteSampleMap(std::uint32_t w, 
+							   std::uint32_t h, 
+							   const std::vector< std::uint32_t >& counts, 
+							   const char* fname = "openmp-cpp-samples.pgm") noexcept {
+		
+		FILE* fp;
+		
+		fopen_s(&fp, fname, "w");
+		
+		const std::uint32_t max_count = std::min(65535u, std::max(1u, *std::max_element(counts.cbegin(), counts.cend())));
+		std::fprintf(fp, "P2\n%u %u\n%u\n", w, h, max_count);
+		for (std::size_t i = 0; i < w * h; ++i) {
+			std::fprintf(fp, "%u ", std::min(counts[i], max_count));
+		}
+		
+		std::fclose(fp);
+	}
+
+	inline void WriteTileCosts(const std::vector< Tile >& tiles, 
+							   const std::vector< double >& costs, 
+							   const char* fname = "openmp-cpp-tile-costs.txt") noexcept {
+		
+		FILE* fp;
+		
+		fopen_s(&fp, fname, "w");
+		
+		std::fprintf(fp, "# x y width height seconds\n");
+		for (std::size_t i = 0; i < tiles.size(); ++i) {
+			std::fprintf(fp, "%u %u %u %u %.6f\n", 
+						 tiles[i].m_x0, 
+						 tiles[i].m_y0, 
+						 tiles[i].m_x1 - tiles[i].m_x0, 
+						 tiles[i].m_y1 - tiles[i].m_y0, 
+						 costs[i]);
+		}
+		
+		std::fclose(fp);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "sampling.hpp"
+#include "sphere.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: LightSampling_t
+	//-------------------------------------------------------------------------
+
+	// How diffuse hits gather the light of the emissive spheres.
+	enum struct LightSampling_t : std::uint8_t {
+		None = 0u,  // only by hitting them (sampling the BSDF)
+		Lights,     // only by sampling them (next event estimation)
+		MISBalance, // both, weighted by the balance heuristic
+		MISPower    // both, weighted by the power heuristic
+	};
+
+	// "nee", "mis_balance" or "mis" (power heuristic); None otherwise.
+	[[nodiscard]]
+	inline LightSampling_t ParseLightSampling(const char* str) noexcept {
+		if (0 == std::strcmp(str, "nee")) {
+			return LightSampling_t::Lights;
+		}
+		if (0 == std::strcmp(str, "mis_balance")) {
+			return LightSampling_t::MISBalance;
+		}
+		if (0 == std::strcmp(str, "mis")) {
+			return LightSampling_t::MISPower;
+		}
+		return LightSampling_t::None;
+	}
+
+	// The weight of a direction sampled on a light with density light_pdf,
+	// which BSDF sampling draws with density bsdf_pdf. A direction the BSDF
+	// sampled gets 1 - LightSamplingWeight(light_pdf, bsdf_pdf).
+	[[nodiscard]]
+	inline double LightSamplingWeight(LightSampling_t light_sampling,
+									  double light_pdf,
+									  double bsdf_pdf) noexcept {
+		switch (light_sampling) {
+		case LightSampling_t::None:
+			return 0.0;
+		case LightSampling_t::MISBalance:
+			return BalanceHeuristic(light_pdf, bsdf_pdf);
+		case LightSampling_t::MISPower:
+			return PowerHeuristic(light_pdf, bsdf_pdf);
+		default:
+			return (0.0 < light_pdf) ? 1.0 : 0.0;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Sphere Lights
+	//-------------------------------------------------------------------------
+
+	// 1 - cos_theta_max for the cone of half angle theta_max that the light
+	// subtends from p, or 0 if p lies within the light.
+	[[nodiscard]]
+	inline double SubtendedCone(const Sphere& light, const Vector3& p) noexcept {
+		const Vector3 pc = light.m_p - p;
+		const double sin_theta_max2 = light.m_r * light.m_r / pc.Dot(pc);
+		if (1.0 <= sin_theta_max2) {
+			return 0.0;
+		}
+		return sin_theta_max2 / (1.0 + std::sqrt(1.0 - sin_theta_max2));
+	}
+
+	// The density per unit solid angle with which SampleSphereLight draws a
+	// direction from p towards the light (the same for all of them).
+	[[nodiscard]]
+	inline double SphereLightPdf(const Sphere& light, const Vector3& p) noexcept {
+		const double one_minus_cos_theta_max = SubtendedCone(light, p);
+		return (0.0 < one_minus_cos_theta_max) ? UniformConePdf(one_minus_cos_theta_max) : 0.0;
+	}
+
+	struct LightSample {
+		Vector3 m_d;
+		double m_pdf; // per unit solid angle
+	};
+
+	// A direction from p uniformly distributed over the solid angle of the
+	// light (the cone it subtends), unless p lies within the light.
+	[[nodiscard]]
+	inline std::optional< LightSample > SampleSphereLight(const Sphere& light,
+														  const Vector3& p,
+														  double u1,
+														  double u2) noexcept {
+		const double one_minus_cos_theta_max = SubtendedCone(light, p);
+		if (0.0 >= one_minus_cos_theta_max) {
+			return {};
+		}
+
+		const Vector3 w = Normalize(light.m_p - p);
+		const Vector3 u = Normalize((std::abs(w.m_x) > 0.1 ? Vector3(0.0, 1.0, 0.0) : Vector3(1.0, 0.0, 0.0)).Cross(w));
+		const Vector3 v = w.Cross(u);
+
+		const Vector3 sample_d = UniformSampleInCone(u1, u2, one_minus_cos_theta_max);
+		return LightSample{
+			Normalize(sample_d.m_x * u + sample_d.m_y * v + sample_d.m_z * w),
+			UniformConePdf(one_minus_cos_theta_max)
+		};
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "geometry.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	constexpr std::size_t g_packet_size = 16u;
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: RayPacket
+	//-------------------------------------------------------------------------
+
+	// Up to g_packet_size rays stored as a structure of arrays, so the packet
+	// kernels intersect one sphere with several rays per instruction. The
+	// rays occupy the lanes [0, size()); m_active_lanes and m_hit_lanes hold
+	// one bit per lane.
+	struct alignas(64) RayPacket {
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		[[nodiscard]]
+		std::size_t size() const noexcept {
+			return m_nb_rays;
+		}
+
+		[[nodiscard]]
+		bool empty() const noexcept {
+			return 0u == m_nb_rays;
+		}
+
+		[[nodiscard]]
+		bool full() const noexcept {
+			return g_packet_size == m_nb_rays;
+		}
+
+		void clear() noexcept {
+			m_nb_rays      = 0u;
+			m_active_lanes = 0u;
+			m_hit_lanes    = 0u;
+		}
+
+		void push_back(const Ray& ray) noexcept {
+			const std::size_t lane = m_nb_rays++;
+			m_ox[lane]    = ray.m_o.m_x;
+			m_oy[lane]    = ray.m_o.m_y;
+			m_oz[lane]    = ray.m_o.m_z;
+			m_dx[lane]    = ray.m_d.m_x;
+			m_dy[lane]    = ray.m_d.m_y;
+			m_dz[lane]    = ray.m_d.m_z;
+			m_tmin[lane]  = ray.m_tmin;
+			m_tmax[lane]  = ray.m_tmax;
+			m_depth[lane] = ray.m_depth;
+			m_hit[lane]   = -1;
+			m_active_lanes |= 1u << lane;
+		}
+
+		// The ray of the given lane, with m_tmax updated by the intersection.
+		[[nodiscard]]
+		const Ray GetRay(std::size_t lane) const noexcept {
+			return Ray(Vector3(m_ox[lane], m_oy[lane], m_oz[lane]),
+					   Vector3(m_dx[lane], m_dy[lane], m_dz[lane]),
+					   m_tmin[lane], m_tmax[lane], m_depth[lane]);
+		}
+
+		[[nodiscard]]
+		std::optional< std::size_t > GetHit(std::size_t lane) const noexcept {
+			if (0u == (m_hit_lanes & (1u << lane))) {
+				return {};
+			}
+			return static_cast< std::size_t >(m_hit[lane]);
+		}
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		// The kernels process whole groups of lanes, so the unused lanes are
+		// kept initialized.
+		double m_ox[g_packet_size] = {}, m_oy[g_packet_size] = {}, m_oz[g_packet_size] = {};
+		double m_dx[g_packet_size] = {}, m_dy[g_packet_size] = {}, m_dz[g_packet_size] = {};
+		double m_tmin[g_packet_size] = {}, m_tmax[g_packet_size] = {};
+		std::int32_t m_hit[g_packet_size] = {}; // index of the closest sphere
+		std::uint32_t m_depth[g_packet_size] = {};
+
+		std::size_t m_nb_rays = 0u;
+		std::uint32_t m_active_lanes = 0u;
+		std::uint32_t m_hit_lanes = 0u;
+	};
+}
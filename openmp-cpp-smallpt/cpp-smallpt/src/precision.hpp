@@ -0,0 +1,223 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "rng.hpp"
+#include "sampling.hpp"
+#include "specular.hpp"
+#include "sphere.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Reference Path Tracer
+	//-------------------------------------------------------------------------
+
+	// A plain path tracer in the scalar type T over BasicSphere< T > (the
+	// closest hit by a linear scan), to compare single and double precision.
+	// Each pixel draws its random numbers from its own stream, so the images
+	// of both precisions only differ by rounding (and the paths it diverts).
+
+	template< typename T >
+	[[nodiscard]]
+	inline std::optional< std::size_t > IntersectLinear(std::span< const BasicSphere< T > > spheres,
+														const BasicRay< T >& ray) noexcept {
+		std::optional< std::size_t > hit;
+		for (std::size_t i = 0u; i < spheres.size(); ++i) {
+			if (spheres[i].Intersect(ray)) {
+				hit = i;
+			}
+		}
+		return hit;
+	}
+
+	template< typename T >
+	[[nodiscard]]
+	const BasicVector3< T > ReferenceRadiance(std::span< const BasicSphere< T > > spheres,
+											  BasicRay< T > r,
+											  RNG& rng) noexcept {
+		constexpr T epsilon  = g_epsilon_sphere< T >;
+		constexpr T infinity = std::numeric_limits< T >::infinity();
+
+		BasicVector3< T > L;
+		BasicVector3< T > F(T(1));
+
+		while (true) {
+			const std::optional< std::size_t > hit = IntersectLinear(spheres, r);
+			if (!hit) {
+				return L;
+			}
+
+			const BasicSphere< T >& shape = spheres[hit.value()];
+			const BasicVector3< T > p = r(r.m_tmax);
+			const BasicVector3< T > n = Normalize(p - shape.m_p);
+
+			L += F * shape.m_e;
+			F *= shape.m_f;
+
+			// Russian roulette
+			if (4u < r.m_depth) {
+				const T continue_probability = shape.m_f.Max();
+				if (rng.Uniform() >= continue_probability) {
+					return L;
+				}
+				F /= continue_probability;
+			}
+
+			// Next path segment
+			switch (shape.m_reflection_t) {
+
+			case Reflection_t::Specular: {
+				const BasicVector3< T > d = IdealSpecularReflect(r.m_d, n);
+				r = BasicRay< T >(p, d, epsilon, infinity, r.m_depth + 1u);
+				break;
+			}
+
+			case Reflection_t::Refractive: {
+				T pr;
+				const BasicVector3< T > d = IdealSpecularTransmit(r.m_d, n, T(g_refractive_index_out), T(g_refractive_index_in), pr, rng);
+				F *= pr;
+				r = BasicRay< T >(p, d, epsilon, infinity, r.m_depth + 1u);
+				break;
+			}
+
+			default: {
+				const BasicVector3< T > w = (T(0) > n.Dot(r.m_d)) ? n : -n;
+				const BasicVector3< T > u = Normalize((std::abs(w.m_x) > T(0.1) ? BasicVector3< T >(T(0), T(1), T(0))
+																				 : BasicVector3< T >(T(1), T(0), T(0))).Cross(w));
+				const BasicVector3< T > v = w.Cross(u);
+
+				const BasicVector3< T > sample_d = CosineWeightedSampleOnHemisphere(static_cast< T >(rng.Uniform()),
+																					static_cast< T >(rng.Uniform()));
+				const BasicVector3< T > d = Normalize(sample_d.m_x * u + sample_d.m_y * v + sample_d.m_z * w);
+				r = BasicRay< T >(p, d, epsilon, infinity, r.m_depth + 1u);
+				break;
+			}
+
+			}
+		}
+	}
+
+	// Renders the spheres with the camera of Render at a w x h resolution and
+	// nb_samples samples per subpixel, in the scalar type T. The (clamped)
+	// pixel values are returned in double precision, for comparison.
+	template< typename T >
+	[[nodiscard]]
+	std::vector< Vector3 > RenderReference(std::span< const Sphere > spheres,
+										   std::uint32_t w,
+										   std::uint32_t h,
+										   std::uint32_t nb_samples,
+										   std::uint32_t seed) {
+		const std::vector< BasicSphere< T > > scene(spheres.begin(), spheres.end());
+
+		const BasicVector3< T > eye  = BasicVector3< T >(Vector3(50.0, 52.0, 295.6));
+		const BasicVector3< T > gaze = BasicVector3< T >(Normalize(Vector3(0.0, -0.042612, -1.0)));
+		const T fov                  = T(0.5135);
+		const BasicVector3< T > cx   = { w * fov / h, T(0), T(0) };
+		const BasicVector3< T > cy   = Normalize(cx.Cross(gaze)) * fov;
+
+		std::vector< Vector3 > Ls(static_cast< std::size_t >(w) * h);
+		for (std::size_t y = 0u; y < h; ++y) { // pixel row
+			for (std::size_t x = 0u; x < w; ++x) { // pixel column
+				const std::size_t i = (h - 1u - y) * w + x;
+				RNG rng(seed, i);
+
+				for (std::size_t sy = 0u; sy < 2u; ++sy) { // 2 subpixel row
+					for (std::size_t sx = 0u; sx < 2u; ++sx) { // 2 subpixel column
+						BasicVector3< T > L;
+						for (std::size_t s = 0u; s < nb_samples; ++s) { // samples per subpixel
+							const T u1 = T(2) * static_cast< T >(rng.Uniform());
+							const T u2 = T(2) * static_cast< T >(rng.Uniform());
+							const T dx = u1 < T(1) ? std::sqrt(u1) - T(1) : T(1) - std::sqrt(T(2) - u1);
+							const T dy = u2 < T(1) ? std::sqrt(u2) - T(1) : T(1) - std::sqrt(T(2) - u2);
+							const BasicVector3< T > d = cx * (((sx + T(0.5) + dx) * T(0.5) + x) / w - T(0.5)) +
+														cy * (((sy + T(0.5) + dy) * T(0.5) + y) / h - T(0.5)) + gaze;
+							const BasicRay< T > ray(eye + d * T(130), Normalize(d), g_epsilon_sphere< T >);
+							L += ReferenceRadiance< T >(scene, ray, rng) / static_cast< T >(nb_samples);
+						}
+						Ls[i] += 0.25 * Clamp(Vector3(L));
+					}
+				}
+			}
+		}
+
+		return Ls;
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Precision Benchmark
+	//-------------------------------------------------------------------------
+
+	struct PrecisionComparison {
+		double m_float_time;
+		double m_double_time;
+		// The RMS, mean (signed) and maximum per-channel difference of the
+		// float image to the double one. A nonzero mean reveals systematic
+		// errors, such as self-intersections darkening the image.
+		double m_rmse;
+		double m_mean_error;
+		double m_max_error;
+		// The RMS difference of two double images with different seeds: the
+		// level of the noise, for scale.
+		double m_noise_rmse;
+	};
+
+	// Renders the spheres in single and in double precision (see
+	// RenderReference), and compares their throughput and images.
+	[[nodiscard]]
+	inline PrecisionComparison ComparePrecision(std::span< const Sphere > spheres,
+												std::uint32_t w,
+												std::uint32_t h,
+												std::uint32_t nb_samples) {
+		const auto float_start = std::chrono::steady_clock::now();
+		const std::vector< Vector3 > Ls_float = RenderReference< float >(spheres, w, h, nb_samples, g_default_seed);
+		const auto double_start = std::chrono::steady_clock::now();
+		const std::vector< Vector3 > Ls_double = RenderReference< double >(spheres, w, h, nb_samples, g_default_seed);
+		const auto double_end = std::chrono::steady_clock::now();
+		const std::vector< Vector3 > Ls_noise = RenderReference< double >(spheres, w, h, nb_samples, g_default_seed + 1u);
+
+		PrecisionComparison comparison = {};
+		comparison.m_float_time  = std::chrono::duration< double >(double_start - float_start).count();
+		comparison.m_double_time = std::chrono::duration< double >(double_end - double_start).count();
+
+		double error2 = 0.0;
+		double noise2 = 0.0;
+		for (std::size_t i = 0u; i < Ls_double.size(); ++i) {
+			const Vector3 error = Ls_float[i] - Ls_double[i];
+			const Vector3 noise = Ls_noise[i] - Ls_double[i];
+			error2 += error.Norm2_squared();
+			noise2 += noise.Norm2_squared();
+			comparison.m_mean_error += error.m_x + error.m_y + error.m_z;
+			comparison.m_max_error   = std::max(comparison.m_max_error, Abs(error).Max());
+		}
+		comparison.m_rmse       = std::sqrt(error2 / (3u * Ls_double.size()));
+		comparison.m_mean_error /= 3u * Ls_double.size();
+		comparison.m_noise_rmse = std::sqrt(noise2 / (3u * Ls_double.size()));
+		return comparison;
+	}
+}
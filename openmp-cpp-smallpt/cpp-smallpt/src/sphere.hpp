@@ -37,39 +37,56 @@ namespace smallpt {
 	// Declarations and Definitions: Sphere
 	//-------------------------------------------------------------------------
 
-	struct Sphere {
+	// The distance a ray leaving a sphere surface must travel before it can
+	// hit a sphere again. In single precision, the hit points themselves are
+	// only accurate to about 1e-5 (at coordinates of about 100).
+	template< typename T >
+	constexpr T g_epsilon_sphere = static_cast< T >(EPSILON_SPHERE);
+	template<>
+	constexpr float g_epsilon_sphere< float > = 1e-3f;
+
+	// A sphere of the scalar type T (float or double).
+	template< typename T >
+	struct BasicSphere {
 
 		//---------------------------------------------------------------------
 		// Constructors and Destructors
 		//---------------------------------------------------------------------
 
-		constexpr explicit Sphere(double r, 
-								  Vector3 p, 
-								  Vector3 e, 
-								  Vector3 f, 
-								  Reflection_t reflection_t) noexcept
+		constexpr explicit BasicSphere(T r, 
+									   BasicVector3< T > p, 
+									   BasicVector3< T > e, 
+									   BasicVector3< T > f, 
+									   Reflection_t reflection_t) noexcept
 			: m_r(r), 
 			m_p(std::move(p)), 
 			m_e(std::move(e)), 
 			m_f(std::move(f)), 
 			m_reflection_t(reflection_t) {}
-		constexpr Sphere(const Sphere& sphere) noexcept = default;
-		constexpr Sphere(Sphere&& sphere) noexcept = default;
-		~Sphere() = default;
+		template< typename U >
+		constexpr explicit BasicSphere(const BasicSphere< U >& sphere) noexcept
+			: m_r(static_cast< T >(sphere.m_r)), 
+			m_p(sphere.m_p), 
+			m_e(sphere.m_e), 
+			m_f(sphere.m_f), 
+			m_reflection_t(sphere.m_reflection_t) {}
+		constexpr BasicSphere(const BasicSphere& sphere) noexcept = default;
+		constexpr BasicSphere(BasicSphere&& sphere) noexcept = default;
+		~BasicSphere() = default;
 
 		//---------------------------------------------------------------------
 		// Assignment Operators
 		//---------------------------------------------------------------------
 
-		Sphere& operator=(const Sphere& sphere) = default;
-		Sphere& operator=(Sphere&& sphere) = default;
+		BasicSphere& operator=(const BasicSphere& sphere) = default;
+		BasicSphere& operator=(BasicSphere&& sphere) = default;
 		
 		//---------------------------------------------------------------------
 		// Member Methods
 		//---------------------------------------------------------------------
 
 		[[nodiscard]]
-		constexpr bool Intersect(const Ray& ray) const noexcept {
+		constexpr bool Intersect(const BasicRay< T >& ray) const noexcept {
 			// (o + t*d - p) . (o + t*d - p) - r*r = 0
 			// <=> (d . d) * t^2 + 2 * d . (o - p) * t + (o - p) . (o - p) - r*r = 0
 			// 
@@ -83,24 +100,44 @@ namespace smallpt {
 			// Solutions
 			// t = (- 2 * d . (o - p) +- 2 * sqrt(D)) / (2 * (d . d))
 			// <=> t = dop +- sqrt(D)
-
-			const Vector3 op = m_p - ray.m_o;
-			const double dop = ray.m_d.Dot(op);
-			const double D = dop * dop - op.Dot(op) + m_r * m_r;
-
-			if (0.0 > D) {
+			//
+			// For the 1e5-radius walls, (dop)^2 and op . op are about 1e10, 
+			// and so are dop and sqrt(D) for the rays towards their centers.
+			// Both differences cancel catastrophically in single precision.
+			// Instead, with l = op - dop * d (the center to the closest point
+			// of the line):
+			// D = r*r - l . l = (r - |l|) * (r + |l|)
+			// and the root of the sign of dop, q = dop +- sqrt(D), does not
+			// cancel. The other one follows from their product, c / q with
+			// c = op . op - r*r, which is the distance to the walls from 
+			// inside the box. Since op is rounded to the precision of the 
+			// wall centers (0.008 at 1e5 in single precision), c is computed
+			// in double precision, where the differences of floats are exact.
+
+			const BasicVector3< T > op = m_p - ray.m_o;
+			const T dop = ray.m_d.Dot(op);
+			const BasicVector3< T > l = op - dop * ray.m_d;
+			const T l_norm = l.Norm2();
+			const T D = (m_r - l_norm) * (m_r + l_norm);
+
+			if (T(0) > D) {
 				return false;
 			}
 
-			const double sqrtD = sqrt(D);
+			const T q = dop + std::copysign(std::sqrt(D), dop);
+			const double cx = static_cast< double >(m_p.m_x) - static_cast< double >(ray.m_o.m_x);
+			const double cy = static_cast< double >(m_p.m_y) - static_cast< double >(ray.m_o.m_y);
+			const double cz = static_cast< double >(m_p.m_z) - static_cast< double >(ray.m_o.m_z);
+			const double c  = cx * cx + cy * cy + cz * cz - static_cast< double >(m_r) * static_cast< double >(m_r);
+			const T t_c = static_cast< T >(c / q);
 
-			const double tmin = dop - sqrtD;
+			const T tmin = std::min(q, t_c);
 			if (ray.m_tmin < tmin && tmin < ray.m_tmax) {
 				ray.m_tmax = tmin;
 				return true;
 			}
 
-			const double tmax = dop + sqrtD;
+			const T tmax = std::max(q, t_c);
 			if (ray.m_tmin < tmax && tmax < ray.m_tmax) {
 				ray.m_tmax = tmax;
 				return true;
@@ -113,10 +150,13 @@ namespace smallpt {
 		// Member Variables
 		//---------------------------------------------------------------------
 
-		double m_r;
-		Vector3 m_p; // position
-		Vector3 m_e; // emission
-		Vector3 m_f; // reflection
+		T m_r;
+		BasicVector3< T > m_p; // position
+		BasicVector3< T > m_e; // emission
+		BasicVector3< T > m_f; // reflection
 		Reflection_t m_reflection_t;
 	};
+
+	using Sphere  = BasicSphere< double >;
+	using Spheref = BasicSphere< float >;
 }
@@ -0,0 +1,880 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "aabb.hpp"
+#include "geometry.hpp"
+#include "packet.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: BVHNode
+	//-------------------------------------------------------------------------
+
+	// The nodes are stored depth-first: the first child of an interior node
+	// directly follows it, so only the index of the second child is stored.
+	struct alignas(64) BVHNode {
+
+		[[nodiscard]]
+		constexpr bool IsLeaf() const noexcept {
+			return 0u < m_nb_primitives;
+		}
+
+		AABB m_bounds;
+		std::uint32_t m_offset;        // leaf: first primitive, interior: second child
+		std::uint16_t m_nb_primitives; // 0 for interior nodes
+		std::uint8_t m_axis;           // interior: split axis
+	};
+
+	static_assert(64u == sizeof(BVHNode), "A BVH node should fill one cache line.");
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: BVHUpdate
+	//-------------------------------------------------------------------------
+
+	// How BVH::Refit kept the hierarchy up to date.
+	enum struct BVHUpdate_t : std::uint8_t {
+		Refit = 0u,     // refit the bounds only
+		PartialRebuild, // refit, and rebuilt the subtrees whose cost degraded
+		Rebuild         // rebuilt the whole hierarchy
+	};
+
+	[[nodiscard]]
+	constexpr const char* ToString(BVHUpdate_t type) noexcept {
+		switch (type) {
+		case BVHUpdate_t::PartialRebuild:
+			return "partial rebuild";
+		case BVHUpdate_t::Rebuild:
+			return "rebuild";
+		default:
+			return "refit";
+		}
+	}
+
+	struct BVHUpdate {
+		BVHUpdate_t m_type;
+		// The SAH cost of the refit subtrees of the build relative to their
+		// cost when they were built.
+		double m_cost_ratio;
+		std::size_t m_nb_rebuilt_subtrees;
+	};
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: SerialFor
+	//-------------------------------------------------------------------------
+
+	// Calls body(i) for every i in [0, n) on the calling thread. The BVH is
+	// built with any callable of this shape, such as one running the calls
+	// on the threads of a pool and waiting for all of them to finish.
+	struct SerialFor {
+
+		template< typename BodyT >
+		void operator()(std::size_t n, const BodyT& body) const {
+			for (std::size_t i = 0u; i < n; ++i) {
+				body(i);
+			}
+		}
+	};
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: BVH
+	//-------------------------------------------------------------------------
+
+	// A bounding volume hierarchy over any kind of primitive, given by their
+	// bounds. The primitives themselves are left to the caller, who stores
+	// them in GetPrimitiveOrder() so every leaf covers a contiguous range, and
+	// intersects those ranges in the callbacks passed to Intersect.
+	class BVH {
+
+	public:
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		BVH() = default;
+		// Builds the hierarchy top-down, choosing each split with the surface
+		// area heuristic (SAH) evaluated at the boundaries of nb_bins bins.
+		// 
+		// The nodes above subtrees of at most g_max_subtree_size primitives
+		// are built first, binning and partitioning their primitives in 
+		// chunks run with parallel_for. The subtrees are then built as 
+		// independent tasks run with parallel_for, and spliced into the nodes
+		// above. The hierarchy does not depend on parallel_for or the number
+		// of threads it uses.
+		template< typename ParallelForT = SerialFor >
+		explicit BVH(const std::vector< AABB >& primitive_bounds,
+					 const ParallelForT& parallel_for = {},
+					 std::size_t max_leaf_size = 8u,
+					 std::size_t nb_bins = 16u)
+			: m_nodes(),
+			m_primitive_order(primitive_bounds.size()) {
+
+			if (primitive_bounds.empty()) {
+				return;
+			}
+
+			const std::uint32_t nb_primitives = static_cast< std::uint32_t >(primitive_bounds.size());
+			m_max_leaf_size = std::clamp< std::size_t >(max_leaf_size, 1u, g_max_leaf_size);
+			m_nb_bins = std::max< std::size_t >(2u, nb_bins);
+			BuildState state = {
+				&primitive_bounds,
+				std::vector< Vector3 >(nb_primitives),
+				std::vector< std::uint32_t >(nb_primitives),
+				m_max_leaf_size,
+				m_nb_bins
+			};
+			parallel_for(NumberOfChunks(nb_primitives), [this, &state, nb_primitives](std::size_t chunk) noexcept {
+				const Chunk range = GetChunk(0u, nb_primitives, chunk);
+				for (std::uint32_t i = range.m_begin; i < range.m_end; ++i) {
+					m_primitive_order[i] = i;
+					state.m_centroids[i] = (*state.m_bounds)[i].Centroid();
+				}
+			});
+
+			// The nodes above the subtrees, with a placeholder per subtree.
+			BuildNode(state, m_nodes, parallel_for, &m_subtrees, 0u, nb_primitives, 0u);
+
+			std::vector< std::vector< BVHNode > > subtree_nodes(m_subtrees.size());
+			parallel_for(m_subtrees.size(), [this, &state, &subtree_nodes](std::size_t i) {
+				BuildSubtree(state, m_subtrees[i], subtree_nodes[i]);
+			});
+
+			Splice(subtree_nodes, parallel_for);
+			m_top_cost = TopCost();
+		}
+		BVH(const BVH& bvh) = default;
+		BVH(BVH&& bvh) noexcept = default;
+		~BVH() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		BVH& operator=(const BVH& bvh) = default;
+		BVH& operator=(BVH&& bvh) noexcept = default;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		[[nodiscard]]
+		bool empty() const noexcept {
+			return m_nodes.empty();
+		}
+
+		[[nodiscard]]
+		std::size_t GetNumberOfNodes() const noexcept {
+			return m_nodes.size();
+		}
+
+		// The nodes in depth-first order: the first child of an interior node
+		// directly follows it.
+		[[nodiscard]]
+		const std::vector< BVHNode >& GetNodes() const noexcept {
+			return m_nodes;
+		}
+
+		// The i-th primitive of the hierarchy is primitive GetPrimitiveOrder()[i]
+		// of the bounds it was built from.
+		[[nodiscard]]
+		const std::vector< std::uint32_t >& GetPrimitiveOrder() const noexcept {
+			return m_primitive_order;
+		}
+
+		// Updates the hierarchy to new bounds of the same primitives. Refits
+		// the bounds of all nodes bottom-up, the subtrees of the build (see
+		// the constructor) in parallel with parallel_for. A subtree whose SAH
+		// cost (relative to its surface area) exceeds max_cost_ratio times its
+		// cost when it was built is then rebuilt. If the cost of the nodes 
+		// above the subtrees does (see TopCost), the whole hierarchy is. 
+		// Rebuilds change GetPrimitiveOrder().
+		template< typename ParallelForT = SerialFor >
+		BVHUpdate Refit(const std::vector< AABB >& primitive_bounds,
+						const ParallelForT& parallel_for = {},
+						double max_cost_ratio = 1.3) {
+
+			if (m_nodes.empty()) {
+				return { BVHUpdate_t::Refit, 1.0, 0u };
+			}
+
+			std::vector< double > costs(m_subtrees.size());
+			parallel_for(m_subtrees.size(), [this, &primitive_bounds, &costs](std::size_t i) noexcept {
+				const Subtree& subtree = m_subtrees[i];
+				for (std::uint32_t j = subtree.m_node + subtree.m_nb_nodes; subtree.m_node < j; --j) {
+					RefitNode(primitive_bounds, j - 1u);
+				}
+				costs[i] = SubtreeCost(m_nodes.data() + subtree.m_node, subtree.m_nb_nodes);
+			});
+
+			// The nodes above the subtrees, children first.
+			for (std::size_t i = m_nodes.size(), j = m_subtrees.size(); 0u < i;) {
+				if (0u < j && m_subtrees[j - 1u].m_node + m_subtrees[j - 1u].m_nb_nodes == i) {
+					i = m_subtrees[--j].m_node;
+					continue;
+				}
+
+				RefitNode(primitive_bounds, static_cast< std::uint32_t >(--i));
+			}
+
+			double cost = 0.0;
+			double build_cost = 0.0;
+			for (std::size_t i = 0u; i < m_subtrees.size(); ++i) {
+				cost += costs[i];
+				build_cost += m_subtrees[i].m_cost;
+			}
+			const double cost_ratio = (0.0 < build_cost) ? cost / build_cost : 1.0;
+
+			if (TopCost() > max_cost_ratio * m_top_cost) {
+				*this = BVH(primitive_bounds, parallel_for, m_max_leaf_size, m_nb_bins);
+				return { BVHUpdate_t::Rebuild, cost_ratio, m_subtrees.size() };
+			}
+
+			std::vector< std::uint8_t > rebuild(m_subtrees.size());
+			std::size_t nb_rebuilt_subtrees = 0u;
+			for (std::size_t i = 0u; i < m_subtrees.size(); ++i) {
+				if (costs[i] > max_cost_ratio * m_subtrees[i].m_cost) {
+					rebuild[i] = 1u;
+					++nb_rebuilt_subtrees;
+				}
+			}
+
+			if (0u == nb_rebuilt_subtrees) {
+				return { BVHUpdate_t::Refit, cost_ratio, 0u };
+			}
+
+			// Rebuild the degraded subtrees, and splice them together with 
+			// (copies of) the others into the nodes above.
+			BuildState state = {
+				&primitive_bounds,
+				std::vector< Vector3 >(primitive_bounds.size()),
+				std::vector< std::uint32_t >(primitive_bounds.size()),
+				m_max_leaf_size,
+				m_nb_bins
+			};
+			std::vector< std::vector< BVHNode > > subtree_nodes(m_subtrees.size());
+			parallel_for(m_subtrees.size(), [this, &state, &rebuild, &subtree_nodes](std::size_t i) {
+				Subtree& subtree = m_subtrees[i];
+				std::vector< BVHNode >& nodes = subtree_nodes[i];
+				if (0u == rebuild[i]) {
+					nodes.assign(m_nodes.begin() + subtree.m_node,
+								 m_nodes.begin() + subtree.m_node + subtree.m_nb_nodes);
+					for (BVHNode& node : nodes) {
+						if (!node.IsLeaf()) {
+							node.m_offset -= subtree.m_node;
+						}
+					}
+					return;
+				}
+
+				for (std::uint32_t j = subtree.m_begin; j < subtree.m_end; ++j) {
+					const std::uint32_t primitive = m_primitive_order[j];
+					state.m_centroids[primitive] = (*state.m_bounds)[primitive].Centroid();
+				}
+				BuildSubtree(state, subtree, nodes);
+			});
+
+			Splice(subtree_nodes, parallel_for);
+			return { BVHUpdate_t::PartialRebuild, cost_ratio, nb_rebuilt_subtrees };
+		}
+
+		// Visits the leaves the ray passes through, nearest first, calling
+		// intersect_leaf(begin, end) for their primitives [begin, end). The
+		// callback narrows ray.m_tmax and returns whether it found a hit;
+		// subtrees entered beyond ray.m_tmax are skipped.
+		template< typename LeafT >
+		[[nodiscard]]
+		bool Intersect(const Ray& ray, LeafT&& intersect_leaf) const noexcept {
+			if (m_nodes.empty()) {
+				return false;
+			}
+
+			const Vector3 inv_d = 1.0 / ray.m_d;
+
+			struct Entry {
+				std::uint32_t m_node;
+				double m_t;
+			};
+			Entry stack[g_max_stack_size];
+			std::size_t stack_size = 0u;
+
+			double t_root;
+			if (!m_nodes[0].m_bounds.Intersect(ray.m_o, inv_d, ray.m_tmin, ray.m_tmax, t_root)) {
+				return false;
+			}
+			stack[stack_size++] = { 0u, t_root };
+
+			bool found = false;
+			while (0u < stack_size) {
+				const Entry entry = stack[--stack_size];
+				if (entry.m_t > ray.m_tmax) {
+					continue;
+				}
+
+				std::uint32_t index = entry.m_node;
+				while (true) {
+					const BVHNode& node = m_nodes[index];
+					if (node.IsLeaf()) {
+						found |= intersect_leaf(static_cast< std::size_t >(node.m_offset),
+												static_cast< std::size_t >(node.m_offset) + node.m_nb_primitives);
+						break;
+					}
+
+					std::uint32_t near_child = index + 1u;
+					std::uint32_t far_child  = node.m_offset;
+					double t_near, t_far;
+					const bool hit_near = m_nodes[near_child].m_bounds.Intersect(ray.m_o, inv_d, ray.m_tmin, ray.m_tmax, t_near);
+					const bool hit_far  = m_nodes[far_child].m_bounds.Intersect(ray.m_o, inv_d, ray.m_tmin, ray.m_tmax, t_far);
+
+					if (hit_near && hit_far) {
+						if (t_far < t_near) {
+							std::swap(near_child, far_child);
+							std::swap(t_near, t_far);
+						}
+						stack[stack_size++] = { far_child, t_far };
+						index = near_child;
+					}
+					else if (hit_near) {
+						index = near_child;
+					}
+					else if (hit_far) {
+						index = far_child;
+					}
+					else {
+						break;
+					}
+				}
+			}
+
+			return found;
+		}
+
+		// Returns whether intersect_leaf(begin, end) returns true for any leaf
+		// the ray passes through within (ray.m_tmin, ray.m_tmax), stopping at
+		// the first one. The callback must not narrow ray.m_tmax; the children
+		// are visited in memory order, since any hit ends the query.
+		template< typename LeafT >
+		[[nodiscard]]
+		bool Occluded(const Ray& ray, LeafT&& intersect_leaf) const noexcept {
+			if (m_nodes.empty()) {
+				return false;
+			}
+
+			const Vector3 inv_d = 1.0 / ray.m_d;
+
+			std::uint32_t stack[g_max_stack_size];
+			std::size_t stack_size = 0u;
+
+			double t_root;
+			if (!m_nodes[0].m_bounds.Intersect(ray.m_o, inv_d, ray.m_tmin, ray.m_tmax, t_root)) {
+				return false;
+			}
+			stack[stack_size++] = 0u;
+
+			while (0u < stack_size) {
+				const std::uint32_t index = stack[--stack_size];
+				const BVHNode& node = m_nodes[index];
+				if (node.IsLeaf()) {
+					if (intersect_leaf(static_cast< std::size_t >(node.m_offset),
+									   static_cast< std::size_t >(node.m_offset) + node.m_nb_primitives)) {
+						return true;
+					}
+					continue;
+				}
+
+				const std::uint32_t left  = index + 1u;
+				const std::uint32_t right = node.m_offset;
+				double t_entry;
+				if (m_nodes[right].m_bounds.Intersect(ray.m_o, inv_d, ray.m_tmin, ray.m_tmax, t_entry)) {
+					stack[stack_size++] = right;
+				}
+				if (m_nodes[left].m_bounds.Intersect(ray.m_o, inv_d, ray.m_tmin, ray.m_tmax, t_entry)) {
+					stack[stack_size++] = left;
+				}
+			}
+
+			return false;
+		}
+
+		// Visits the leaves any active ray of the packet passes through, calling
+		// intersect_leaf(begin, end, packet) with m_active_lanes restricted to
+		// the rays entering the leaf. The children of a node are visited in the
+		// order of the direction of the first active ray along the split axis.
+		template< typename LeafT >
+		void Intersect(RayPacket& packet, LeafT&& intersect_leaf) const noexcept {
+			if (m_nodes.empty() || 0u == packet.m_active_lanes) {
+				return;
+			}
+
+			Vector3 inv_ds[g_packet_size];
+			for (std::size_t lane = 0u; lane < packet.size(); ++lane) {
+				inv_ds[lane] = 1.0 / Vector3(packet.m_dx[lane], packet.m_dy[lane], packet.m_dz[lane]);
+			}
+
+			const std::uint32_t active_lanes = packet.m_active_lanes;
+			const std::size_t first_lane = static_cast< std::size_t >(std::countr_zero(active_lanes));
+			const Vector3 first_d(packet.m_dx[first_lane], packet.m_dy[first_lane], packet.m_dz[first_lane]);
+
+			std::uint32_t stack[g_max_stack_size];
+			std::size_t stack_size = 0u;
+			stack[stack_size++] = 0u;
+
+			while (0u < stack_size) {
+				std::uint32_t index = stack[--stack_size];
+				while (true) {
+					const BVHNode& node = m_nodes[index];
+
+					std::uint32_t lanes = 0u;
+					for (std::uint32_t remaining = active_lanes; 0u != remaining; remaining &= remaining - 1u) {
+						const std::size_t lane = static_cast< std::size_t >(std::countr_zero(remaining));
+						const Vector3 o(packet.m_ox[lane], packet.m_oy[lane], packet.m_oz[lane]);
+						double t_entry;
+						if (node.m_bounds.Intersect(o, inv_ds[lane], packet.m_tmin[lane], packet.m_tmax[lane], t_entry)) {
+							lanes |= 1u << lane;
+						}
+					}
+
+					if (0u == lanes) {
+						break;
+					}
+
+					if (node.IsLeaf()) {
+						packet.m_active_lanes = lanes;
+						intersect_leaf(static_cast< std::size_t >(node.m_offset),
+									   static_cast< std::size_t >(node.m_offset) + node.m_nb_primitives,
+									   packet);
+						packet.m_active_lanes = active_lanes;
+						break;
+					}
+
+					const bool far_first = (0.0 > first_d[node.m_axis]);
+					stack[stack_size++] = far_first ? index + 1u : node.m_offset;
+					index = far_first ? node.m_offset : index + 1u;
+				}
+			}
+		}
+
+	private:
+
+		//---------------------------------------------------------------------
+		// Class Member Variables
+		//---------------------------------------------------------------------
+
+		static constexpr std::size_t g_max_leaf_size = 0xFFFFu;
+		// Below this depth splits follow the SAH; beyond it, they halve the
+		// primitives, which bounds the depth (and traversal stack) for any input.
+		static constexpr std::size_t g_max_sah_depth = 64u;
+		static constexpr std::size_t g_max_stack_size = g_max_sah_depth + 64u;
+		// The number of primitives binned or partitioned by a single task.
+		static constexpr std::size_t g_chunk_size = 1024u;
+		// The largest subtree built (and refit) by a single task.
+		static constexpr std::size_t g_max_subtree_size = 4096u;
+		// The cost of traversing a node relative to intersecting a primitive.
+		static constexpr double g_traversal_cost = 0.125;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		struct BuildState {
+			const std::vector< AABB >* m_bounds;
+			std::vector< Vector3 > m_centroids;
+			// The destination of the primitives of chunked partitions.
+			std::vector< std::uint32_t > m_scratch;
+			std::size_t m_max_leaf_size;
+			std::size_t m_nb_bins;
+		};
+
+		struct Bin {
+			AABB m_bounds;
+			std::size_t m_nb_primitives = 0u;
+		};
+
+		struct Subtree {
+			std::uint32_t m_begin; // first primitive
+			std::uint32_t m_end;
+			std::size_t m_depth;
+			std::uint32_t m_node;  // root
+			std::uint32_t m_nb_nodes = 1u;
+			double m_cost = 0.0;   // at the last (re)build (see SubtreeCost)
+		};
+
+		struct Chunk {
+			std::uint32_t m_begin;
+			std::uint32_t m_end;
+		};
+
+		[[nodiscard]]
+		static constexpr std::size_t NumberOfChunks(std::size_t nb_primitives) noexcept {
+			return std::max< std::size_t >(1u, (nb_primitives + g_chunk_size - 1u) / g_chunk_size);
+		}
+
+		[[nodiscard]]
+		static constexpr Chunk GetChunk(std::uint32_t begin, 
+										std::uint32_t end, 
+										std::size_t chunk) noexcept {
+			const std::uint32_t chunk_begin = begin + static_cast< std::uint32_t >(chunk * g_chunk_size);
+			const std::uint32_t chunk_end   = std::min(end, chunk_begin + static_cast< std::uint32_t >(g_chunk_size));
+			return { chunk_begin, chunk_end };
+		}
+
+		// Builds the subtree over the primitives [begin, end) into nodes and
+		// returns the index of its root. Given subtrees, subtrees of at most
+		// g_max_subtree_size primitives are only reserved a placeholder node
+		// and recorded, in depth-first order, to be built later.
+		template< typename ParallelForT >
+		std::uint32_t BuildNode(BuildState& state,
+								std::vector< BVHNode >& nodes,
+								const ParallelForT& parallel_for,
+								std::vector< Subtree >* subtrees,
+								std::uint32_t begin,
+								std::uint32_t end,
+								std::size_t depth) {
+
+			const std::uint32_t index = static_cast< std::uint32_t >(nodes.size());
+			nodes.emplace_back();
+
+			const std::size_t nb_primitives = end - begin;
+			if (subtrees && nb_primitives <= g_max_subtree_size) {
+				subtrees->push_back({ begin, end, depth, index });
+				return index;
+			}
+
+			const std::size_t nb_chunks = NumberOfChunks(nb_primitives);
+
+			// The bounds and centroid bounds of every chunk.
+			std::vector< AABB > chunk_bounds(2u * nb_chunks);
+			parallel_for(nb_chunks, [this, &state, &chunk_bounds, begin, end](std::size_t chunk) noexcept {
+				const Chunk range = GetChunk(begin, end, chunk);
+				for (std::uint32_t i = range.m_begin; i < range.m_end; ++i) {
+					const std::uint32_t primitive = m_primitive_order[i];
+					chunk_bounds[2u * chunk].Extend((*state.m_bounds)[primitive]);
+					chunk_bounds[2u * chunk + 1u].Extend(state.m_centroids[primitive]);
+				}
+			});
+
+			AABB bounds;
+			AABB centroid_bounds;
+			for (std::size_t chunk = 0u; chunk < nb_chunks; ++chunk) {
+				bounds.Extend(chunk_bounds[2u * chunk]);
+				centroid_bounds.Extend(chunk_bounds[2u * chunk + 1u]);
+			}
+			nodes[index].m_bounds = bounds;
+
+			const std::size_t axis = centroid_bounds.Diagonal().MaxDimension();
+			const double axis_min = centroid_bounds.m_min[axis];
+			const double axis_extent = centroid_bounds.m_max[axis] - axis_min;
+
+			const auto make_leaf = [&nodes, index, begin, nb_primitives]() noexcept {
+				nodes[index].m_offset = begin;
+				nodes[index].m_nb_primitives = static_cast< std::uint16_t >(nb_primitives);
+				return index;
+			};
+
+			if (1u == nb_primitives
+				|| (0.0 >= axis_extent && nb_primitives <= state.m_max_leaf_size)) {
+				return make_leaf();
+			}
+
+			std::uint32_t mid = begin + static_cast< std::uint32_t >(nb_primitives / 2u);
+			if (0.0 < axis_extent && depth < g_max_sah_depth) {
+				const std::size_t nb_bins = state.m_nb_bins;
+				const auto bin_of = [&state, axis, axis_min, axis_extent, nb_bins](std::uint32_t primitive) noexcept {
+					const double offset = (state.m_centroids[primitive][axis] - axis_min) / axis_extent;
+					return std::min(nb_bins - 1u, static_cast< std::size_t >(nb_bins * offset));
+				};
+
+				// Bin every chunk separately, and merge the bins of all chunks
+				// into those of the first.
+				std::vector< Bin > bins(nb_chunks * nb_bins);
+				parallel_for(nb_chunks, [this, &state, &bins, &bin_of, begin, end, nb_bins](std::size_t chunk) noexcept {
+					const Chunk range = GetChunk(begin, end, chunk);
+					Bin* const chunk_bins = bins.data() + chunk * nb_bins;
+					for (std::uint32_t i = range.m_begin; i < range.m_end; ++i) {
+						const std::uint32_t primitive = m_primitive_order[i];
+						Bin& bin = chunk_bins[bin_of(primitive)];
+						bin.m_bounds.Extend((*state.m_bounds)[primitive]);
+						++bin.m_nb_primitives;
+					}
+				});
+				for (std::size_t chunk = 1u; chunk < nb_chunks; ++chunk) {
+					for (std::size_t b = 0u; b < nb_bins; ++b) {
+						bins[b].m_bounds.Extend(bins[chunk * nb_bins + b].m_bounds);
+						bins[b].m_nb_primitives += bins[chunk * nb_bins + b].m_nb_primitives;
+					}
+				}
+
+				// Sweep from the right to get the cost of every right part, and
+				// from the left to complete the cost of every split.
+				std::vector< double > right_costs(nb_bins);
+				AABB right_bounds;
+				std::size_t nb_right = 0u;
+				for (std::size_t b = nb_bins - 1u; 0u < b; --b) {
+					right_bounds.Extend(bins[b].m_bounds);
+					nb_right += bins[b].m_nb_primitives;
+					right_costs[b] = nb_right * right_bounds.SurfaceArea();
+				}
+
+				double best_cost = std::numeric_limits< double >::infinity();
+				std::size_t best_split = 0u;
+				AABB left_bounds;
+				std::size_t nb_left = 0u;
+				for (std::size_t b = 1u; b < nb_bins; ++b) {
+					left_bounds.Extend(bins[b - 1u].m_bounds);
+					nb_left += bins[b - 1u].m_nb_primitives;
+					const double cost = nb_left * left_bounds.SurfaceArea() + right_costs[b];
+					if (cost < best_cost) {
+						best_cost = cost;
+						best_split = b;
+					}
+				}
+
+				const double area = bounds.SurfaceArea();
+				best_cost = g_traversal_cost + ((0.0 < area) ? best_cost / area : 0.0);
+				const double leaf_cost = static_cast< double >(nb_primitives);
+				if (nb_primitives <= state.m_max_leaf_size && leaf_cost <= best_cost) {
+					return make_leaf();
+				}
+
+				mid = Partition(state, parallel_for, begin, end,
+								[&bin_of, best_split](std::uint32_t primitive) noexcept {
+									return bin_of(primitive) < best_split;
+								});
+			}
+
+			if (mid == begin || mid == end) {
+				mid = begin + static_cast< std::uint32_t >(nb_primitives / 2u);
+				std::nth_element(m_primitive_order.begin() + begin,
+								 m_primitive_order.begin() + mid,
+								 m_primitive_order.begin() + end,
+								 [&state, axis](std::uint32_t lhs, std::uint32_t rhs) noexcept {
+									 return state.m_centroids[lhs][axis] < state.m_centroids[rhs][axis];
+								 });
+			}
+
+			nodes[index].m_axis = static_cast< std::uint8_t >(axis);
+			nodes[index].m_nb_primitives = 0u;
+			BuildNode(state, nodes, parallel_for, subtrees, begin, mid, depth + 1u);
+			nodes[index].m_offset = BuildNode(state, nodes, parallel_for, subtrees, mid, end, depth + 1u);
+			return index;
+		}
+
+		void BuildSubtree(BuildState& state, Subtree& subtree, std::vector< BVHNode >& nodes) {
+			nodes.reserve(2u * (subtree.m_end - subtree.m_begin) / state.m_max_leaf_size + 1u);
+			BuildNode(state, nodes, SerialFor(), nullptr, subtree.m_begin, subtree.m_end, subtree.m_depth);
+			subtree.m_cost = SubtreeCost(nodes.data(), nodes.size());
+		}
+
+		// Replaces the nodes of every subtree by the given ones (with child 
+		// indices relative to the subtree), which keeps the nodes depth-first,
+		// and relocates the child indices of the nodes above accordingly.
+		template< typename ParallelForT >
+		void Splice(const std::vector< std::vector< BVHNode > >& subtree_nodes,
+					const ParallelForT& parallel_for) {
+
+			std::vector< std::uint32_t > node_indices(m_nodes.size());
+			std::vector< std::uint32_t > subtree_indices(m_subtrees.size());
+			std::uint32_t nb_nodes = 0u;
+			for (std::size_t i = 0u, j = 0u; i < m_nodes.size(); ++i) {
+				node_indices[i] = nb_nodes;
+				if (j < m_subtrees.size() && m_subtrees[j].m_node == i) {
+					i += m_subtrees[j].m_nb_nodes - 1u;
+					subtree_indices[j] = nb_nodes;
+					nb_nodes += static_cast< std::uint32_t >(subtree_nodes[j].size());
+					++j;
+				}
+				else {
+					++nb_nodes;
+				}
+			}
+
+			std::vector< BVHNode > nodes(nb_nodes);
+			for (std::size_t i = 0u, j = 0u; i < m_nodes.size(); ++i) {
+				if (j < m_subtrees.size() && m_subtrees[j].m_node == i) {
+					i += m_subtrees[j].m_nb_nodes - 1u;
+					++j;
+					continue;
+				}
+
+				BVHNode& node = nodes[node_indices[i]];
+				node = m_nodes[i];
+				if (!node.IsLeaf()) {
+					node.m_offset = node_indices[node.m_offset];
+				}
+			}
+			parallel_for(m_subtrees.size(), [this, &nodes, &subtree_nodes, &subtree_indices](std::size_t i) noexcept {
+				const std::uint32_t offset = subtree_indices[i];
+				for (std::size_t j = 0u; j < subtree_nodes[i].size(); ++j) {
+					BVHNode& node = nodes[offset + j];
+					node = subtree_nodes[i][j];
+					if (!node.IsLeaf()) {
+						node.m_offset += offset;
+					}
+				}
+
+				m_subtrees[i].m_node = offset;
+				m_subtrees[i].m_nb_nodes = static_cast< std::uint32_t >(subtree_nodes[i].size());
+			});
+
+			m_nodes = std::move(nodes);
+		}
+
+		void RefitNode(const std::vector< AABB >& primitive_bounds, std::uint32_t index) noexcept {
+			BVHNode& node = m_nodes[index];
+			AABB bounds;
+			if (node.IsLeaf()) {
+				for (std::uint32_t i = node.m_offset; i < node.m_offset + node.m_nb_primitives; ++i) {
+					bounds.Extend(primitive_bounds[m_primitive_order[i]]);
+				}
+			}
+			else {
+				bounds.Extend(m_nodes[index + 1u].m_bounds);
+				bounds.Extend(m_nodes[node.m_offset].m_bounds);
+			}
+			node.m_bounds = bounds;
+		}
+
+		// The SAH cost of a node, times its surface area.
+		[[nodiscard]]
+		static double NodeCost(const BVHNode& node) noexcept {
+			const double cost = node.IsLeaf() ? static_cast< double >(node.m_nb_primitives) : g_traversal_cost;
+			return cost * node.m_bounds.SurfaceArea();
+		}
+
+		// The SAH cost of the subtree of the given nodes, relative to the 
+		// surface area of its root.
+		[[nodiscard]]
+		static double SubtreeCost(const BVHNode* nodes, std::size_t nb_nodes) noexcept {
+			double cost = 0.0;
+			for (std::size_t i = 0u; i < nb_nodes; ++i) {
+				cost += NodeCost(nodes[i]);
+			}
+
+			const double area = nodes[0].m_bounds.SurfaceArea();
+			return (0.0 < area) ? cost / area : 0.0;
+		}
+
+		// The cost of the nodes above the subtrees: the mean number of 
+		// children a ray entering one of these nodes enters, according to the
+		// SAH (the total surface area of the children relative to that of the
+		// node). Unlike the cost of the whole hierarchy, this does not depend
+		// on how much larger the largest primitives are than the others.
+		[[nodiscard]]
+		double TopCost() const noexcept {
+			double cost = 0.0;
+			std::size_t nb_nodes = 0u;
+			for (std::size_t i = 0u, j = 0u; i < m_nodes.size(); ++i) {
+				if (j < m_subtrees.size() && m_subtrees[j].m_node == i) {
+					i += m_subtrees[j].m_nb_nodes - 1u;
+					++j;
+					continue;
+				}
+
+				const BVHNode& node = m_nodes[i];
+				const double area = node.m_bounds.SurfaceArea();
+				if (node.IsLeaf() || 0.0 >= area) {
+					continue;
+				}
+
+				cost += (m_nodes[i + 1u].m_bounds.SurfaceArea() + m_nodes[node.m_offset].m_bounds.SurfaceArea()) / area;
+				++nb_nodes;
+			}
+
+			return (0u < nb_nodes) ? cost / nb_nodes : 0.0;
+		}
+
+		// Moves the primitives of [begin, end) satisfying is_left in front of
+		// the others, and returns the index of the first of the others. Every
+		// chunk counts its primitives on the left, and scatters its primitives
+		// to the positions given by the prefix sums of these counts (which 
+		// keeps the order within either side).
+		template< typename ParallelForT, typename PredicateT >
+		std::uint32_t Partition(BuildState& state,
+								const ParallelForT& parallel_for,
+								std::uint32_t begin,
+								std::uint32_t end,
+								const PredicateT& is_left) {
+
+			const std::size_t nb_chunks = NumberOfChunks(end - begin);
+			if (1u == nb_chunks) {
+				const auto split = std::partition(m_primitive_order.begin() + begin,
+												  m_primitive_order.begin() + end,
+												  is_left);
+				return static_cast< std::uint32_t >(split - m_primitive_order.begin());
+			}
+
+			std::vector< std::uint32_t > lefts(nb_chunks);
+			parallel_for(nb_chunks, [this, &lefts, &is_left, begin, end](std::size_t chunk) noexcept {
+				const Chunk range = GetChunk(begin, end, chunk);
+				std::uint32_t nb_left = 0u;
+				for (std::uint32_t i = range.m_begin; i < range.m_end; ++i) {
+					nb_left += is_left(m_primitive_order[i]) ? 1u : 0u;
+				}
+				lefts[chunk] = nb_left;
+			});
+
+			// The first position on the left of every chunk.
+			std::uint32_t mid = begin;
+			for (std::uint32_t& left : lefts) {
+				const std::uint32_t nb_left = left;
+				left = mid;
+				mid += nb_left;
+			}
+
+			parallel_for(nb_chunks, [this, &state, &lefts, &is_left, begin, end, mid](std::size_t chunk) noexcept {
+				const Chunk range = GetChunk(begin, end, chunk);
+				std::uint32_t left  = lefts[chunk];
+				std::uint32_t right = mid + (range.m_begin - begin) - (left - begin);
+				for (std::uint32_t i = range.m_begin; i < range.m_end; ++i) {
+					const std::uint32_t primitive = m_primitive_order[i];
+					state.m_scratch[is_left(primitive) ? left++ : right++] = primitive;
+				}
+			});
+			parallel_for(nb_chunks, [this, &state, begin, end](std::size_t chunk) noexcept {
+				const Chunk range = GetChunk(begin, end, chunk);
+				std::copy(state.m_scratch.begin() + range.m_begin,
+						  state.m_scratch.begin() + range.m_end,
+						  m_primitive_order.begin() + range.m_begin);
+			});
+
+			return mid;
+		}
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		std::vector< BVHNode > m_nodes;
+		std::vector< std::uint32_t > m_primitive_order;
+
+		// The build parameters and the quality of the last build.
+		std::size_t m_max_leaf_size = 8u;
+		std::size_t m_nb_bins = 16u;
+		std::vector< Subtree > m_subtrees;
+		double m_top_cost = 0.0;
+	};
+}
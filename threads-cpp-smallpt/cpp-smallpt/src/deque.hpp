@@ -0,0 +1,293 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	/**
+	 A class of work-stealing deques (Chase and Lev, "Dynamic Circular
+	 Work-Stealing Deque", with the memory orderings of Le et al., "Correct
+	 and Efficient Work-Stealing for Weak Memory Models").
+
+	 Only the owning thread may call @c Push and @c Pop (at the bottom of
+	 the deque). Any thread may call @c Steal (at the top of the deque).
+
+	 @tparam		T
+					The (trivially copyable) element type.
+	 */
+	template< typename T >
+	class WorkStealingDeque final {
+
+	public:
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		/**
+		 Constructs a work-stealing deque.
+
+		 @param[in]		capacity
+						The initial capacity (a power of two).
+		 */
+		explicit WorkStealingDeque(std::size_t capacity = 64u)
+			: m_top(0),
+			m_bottom(0),
+			m_array(nullptr),
+			m_arrays() {
+
+			m_arrays.push_back(std::make_unique< Array >(capacity));
+			m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+		}
+
+		/**
+		 Constructs a work-stealing deque from the given work-stealing deque.
+
+		 @param[in]		deque
+						A reference to the work-stealing deque to copy.
+		 */
+		WorkStealingDeque(const WorkStealingDeque& deque) = delete;
+
+		/**
+		 Constructs a work-stealing deque by moving the given work-stealing
+		 deque.
+
+		 @param[in]		deque
+						A reference to the work-stealing deque to move.
+		 */
+		WorkStealingDeque(WorkStealingDeque&& deque) = delete;
+
+		/**
+		 Destructs this work-stealing deque.
+		 */
+		~WorkStealingDeque() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		/**
+		 Copies the given work-stealing deque to this work-stealing deque.
+
+		 @param[in]		deque
+						A reference to the work-stealing deque to copy.
+		 @return		A reference to the copy of the given work-stealing
+						deque (i.e. this work-stealing deque).
+		 */
+		WorkStealingDeque& operator=(const WorkStealingDeque& deque) = delete;
+
+		/**
+		 Moves the given work-stealing deque to this work-stealing deque.
+
+		 @param[in]		deque
+						A reference to the work-stealing deque to move.
+		 @return		A reference to the moved work-stealing deque
+						(i.e. this work-stealing deque).
+		 */
+		WorkStealingDeque& operator=(WorkStealingDeque&& deque) = delete;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		/**
+		 Pushes the given element at the bottom of this work-stealing deque.
+
+		 Must only be called by the owning thread.
+
+		 @param[in]		element
+						The element.
+		 */
+		void Push(T element) {
+			const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+			const std::int64_t t = m_top.load(std::memory_order_acquire);
+			Array* array = m_array.load(std::memory_order_relaxed);
+
+			if (static_cast< std::int64_t >(array->Capacity()) - 1 < b - t) {
+				array = Grow(array, b, t);
+			}
+
+			array->Put(b, element);
+			std::atomic_thread_fence(std::memory_order_release);
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+		}
+
+		/**
+		 Pops an element from the bottom of this work-stealing deque.
+
+		 Must only be called by the owning thread.
+
+		 @param[out]	element
+						A reference to the popped element.
+		 @return		@c true if an element is popped. @c false otherwise.
+		 */
+		[[nodiscard]]
+		bool Pop(T& element) noexcept {
+			const std::int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+			Array* const array = m_array.load(std::memory_order_relaxed);
+			m_bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			std::int64_t t = m_top.load(std::memory_order_relaxed);
+
+			if (b < t) {
+				// Empty deque.
+				m_bottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			element = array->Get(b);
+			if (b == t) {
+				// Last element: race against thieves.
+				const bool won = m_top.compare_exchange_strong(t, t + 1,
+															   std::memory_order_seq_cst,
+															   std::memory_order_relaxed);
+				m_bottom.store(b + 1, std::memory_order_relaxed);
+				return won;
+			}
+
+			return true;
+		}
+
+		/**
+		 Steals an element from the top of this work-stealing deque.
+
+		 May be called by any thread.
+
+		 @param[out]	element
+						A reference to the stolen element.
+		 @return		@c true if an element is stolen. @c false if this
+						work-stealing deque is empty or if another thread
+						won the race for the top element.
+		 */
+		[[nodiscard]]
+		bool Steal(T& element) noexcept {
+			std::int64_t t = m_top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const std::int64_t b = m_bottom.load(std::memory_order_acquire);
+
+			if (b <= t) {
+				return false;
+			}
+
+			Array* const array = m_array.load(std::memory_order_acquire);
+			element = array->Get(t);
+			return m_top.compare_exchange_strong(t, t + 1,
+												 std::memory_order_seq_cst,
+												 std::memory_order_relaxed);
+		}
+
+		/**
+		 Checks whether this work-stealing deque is empty.
+
+		 @return		@c true if this work-stealing deque is empty at the
+						time of the call. @c false otherwise.
+		 */
+		[[nodiscard]]
+		bool Empty() const noexcept {
+			const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+			const std::int64_t t = m_top.load(std::memory_order_relaxed);
+			return b <= t;
+		}
+
+	private:
+
+		/**
+		 A class of circular arrays.
+		 */
+		class Array final {
+
+		public:
+
+			explicit Array(std::size_t capacity)
+				: m_mask(capacity - 1u),
+				m_elements(new std::atomic< T >[capacity]) {}
+
+			[[nodiscard]]
+			std::size_t Capacity() const noexcept {
+				return m_mask + 1u;
+			}
+
+			[[nodiscard]]
+			T Get(std::int64_t i) const noexcept {
+				return m_elements[static_cast< std::size_t >(i) & m_mask].load(std::memory_order_relaxed);
+			}
+
+			void Put(std::int64_t i, T element) noexcept {
+				m_elements[static_cast< std::size_t >(i) & m_mask].store(element, std::memory_order_relaxed);
+			}
+
+		private:
+
+			std::size_t m_mask;
+			std::unique_ptr< std::atomic< T >[] > m_elements;
+		};
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		/**
+		 Doubles the capacity of the given array of this work-stealing deque.
+
+		 The old array is retained until destruction, since thieves may
+		 still be reading from it.
+
+		 @param[in]		array
+						A pointer to the current array.
+		 @param[in]		b
+						The bottom index.
+		 @param[in]		t
+						The top index.
+		 @return		A pointer to the new array.
+		 */
+		Array* Grow(Array* array, std::int64_t b, std::int64_t t) {
+			auto new_array = std::make_unique< Array >(2u * array->Capacity());
+			for (std::int64_t i = t; i < b; ++i) {
+				new_array->Put(i, array->Get(i));
+			}
+
+			Array* const result = new_array.get();
+			m_arrays.push_back(std::move(new_array));
+			m_array.store(result, std::memory_order_release);
+			return result;
+		}
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		/**
+		 The top index of this work-stealing deque.
+		 */
+		alignas(64) std::atomic< std::int64_t > m_top;
+
+		/**
+		 The bottom index of this work-stealing deque.
+		 */
+		alignas(64) std::atomic< std::int64_t > m_bottom;
+
+		/**
+		 A pointer to the current array of this work-stealing deque.
+		 */
+		std::atomic< Array* > m_array;
+
+		/**
+		 The current and all retired arrays of this work-stealing deque.
+		 */
+		std::vector< std::unique_ptr< Array > > m_arrays;
+	};
+}
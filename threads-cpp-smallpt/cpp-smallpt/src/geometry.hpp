@@ -14,7 +14,10 @@
 //-----------------------------------------------------------------------------
 namespace smallpt {
 
-	struct Ray {
+	// A ray of the scalar type T (float or double), whose valid distances 
+	// lie within (m_tmin, m_tmax).
+	template< typename T >
+	struct BasicRay {
 
 	public:
 
@@ -22,33 +25,33 @@ namespace smallpt {
 		// Constructors and Destructors
 		//---------------------------------------------------------------------
 
-		constexpr explicit Ray(Vector3 o, 
-							   Vector3 d, 
-							   double tmin = 0.0, 
-							   double tmax = std::numeric_limits< double >::infinity(), 
-							   std::uint32_t depth = 0u) noexcept
+		constexpr explicit BasicRay(BasicVector3< T > o, 
+									BasicVector3< T > d, 
+									T tmin = T(0), 
+									T tmax = std::numeric_limits< T >::infinity(), 
+									std::uint32_t depth = 0u) noexcept
 			: m_o(std::move(o)), 
 			m_d(std::move(d)),
 			m_tmin(tmin), 
 			m_tmax(tmax), 
 			m_depth(depth) {};
-		constexpr Ray(const Ray& ray) noexcept = default;
-		constexpr Ray(Ray&& ray) noexcept = default;
-		~Ray() = default;
+		constexpr BasicRay(const BasicRay& ray) noexcept = default;
+		constexpr BasicRay(BasicRay&& ray) noexcept = default;
+		~BasicRay() = default;
 
 		//---------------------------------------------------------------------
 		// Assignment Operators
 		//---------------------------------------------------------------------
 
-		Ray& operator=(const Ray& ray) = default;
-		Ray& operator=(Ray&& ray) = default;
+		BasicRay& operator=(const BasicRay& ray) = default;
+		BasicRay& operator=(BasicRay&& ray) = default;
 
 		//---------------------------------------------------------------------
 		// Member Methods
 		//---------------------------------------------------------------------
 
 		[[nodiscard]]
-		constexpr const Vector3 operator()(double t) const noexcept { 
+		constexpr const BasicVector3< T > operator()(T t) const noexcept { 
 			return m_o + m_d * t; 
 		}
 
@@ -56,11 +59,14 @@ namespace smallpt {
 		// Member Variables
 		//---------------------------------------------------------------------
 
-		Vector3 m_o, m_d;
-		mutable double m_tmin, m_tmax;
+		BasicVector3< T > m_o, m_d;
+		mutable T m_tmin, m_tmax;
 		std::uint32_t m_depth;
 	};
 
+	using Ray  = BasicRay< double >;
+	using Rayf = BasicRay< float >;
+
 	inline std::ostream &operator<<(std::ostream& os, const Ray& r) {
 		os << "o: " << r.m_o << std::endl;
 		os << "d: " << r.m_d << std::endl;
@@ -12,7 +12,9 @@
 //-----------------------------------------------------------------------------
 #pragma region
 
-#include <limits.h>
+#ifdef SMALLPT_WIN32_THREADS
+	#include <limits.h>
+#endif
 
 #pragma endregion
 
@@ -21,6 +23,8 @@
 //-----------------------------------------------------------------------------
 namespace smallpt {
 
+	#ifdef SMALLPT_WIN32_THREADS
+
 	//-------------------------------------------------------------------------
 	// Mutex
 	//-------------------------------------------------------------------------
@@ -183,4 +187,101 @@ namespace smallpt {
 
 		EnterCriticalSection(&m_condition_mutex);
 	}
+
+	#else
+
+	//-------------------------------------------------------------------------
+	// Mutex
+	//-------------------------------------------------------------------------
+	Mutex::Mutex() 
+		: m_mutex() {}
+
+	Mutex::~Mutex() = default;
+
+	//-------------------------------------------------------------------------
+	// MutexLock
+	//-------------------------------------------------------------------------
+	MutexLock::MutexLock(Mutex& mutex)
+		: m_mutex(mutex) {
+		// Blocks until the calling thread is granted ownership.
+		m_mutex.m_mutex.lock();
+	}
+
+	MutexLock::~MutexLock() {
+		m_mutex.m_mutex.unlock();
+	}
+
+	//-------------------------------------------------------------------------
+	// Semaphore
+	//-------------------------------------------------------------------------
+	Semaphore::Semaphore() 
+		: m_count(0u), 
+		m_mutex(), 
+		m_condition() {}
+
+	Semaphore::~Semaphore() = default;
+
+	void Semaphore::Signal(std::uint32_t count) noexcept {
+		{
+			std::lock_guard< std::mutex > lock(m_mutex);
+			m_count += count;
+		}
+
+		if (1u == count) {
+			m_condition.notify_one();
+		}
+		else {
+			m_condition.notify_all();
+		}
+	}
+
+	void Semaphore::Wait() noexcept {
+		std::unique_lock< std::mutex > lock(m_mutex);
+		m_condition.wait(lock, [this]() noexcept { 
+			return 0u < m_count; 
+		});
+		--m_count;
+	}
+
+	[[nodiscard]]
+	bool Semaphore::TryWait() noexcept {
+		std::lock_guard< std::mutex > lock(m_mutex);
+		if (0u == m_count) {
+			return false;
+		}
+
+		--m_count;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+	// ConditionVariable
+	//-------------------------------------------------------------------------
+	ConditionVariable::ConditionVariable()
+		: m_condition_mutex(), 
+		m_condition() {}
+	
+	ConditionVariable::~ConditionVariable() = default;
+
+	void ConditionVariable::Lock() noexcept {
+		m_condition_mutex.lock();
+	}
+
+	void ConditionVariable::Unlock() noexcept {
+		m_condition_mutex.unlock();
+	}
+
+	void ConditionVariable::Signal() noexcept {
+		m_condition.notify_one();
+	}
+
+	void ConditionVariable::Wait() noexcept {
+		// The caller owns the condition mutex: adopt it for the duration of
+		// the wait and hand ownership back afterwards.
+		std::unique_lock< std::mutex > lock(m_condition_mutex, std::adopt_lock);
+		m_condition.wait(lock);
+		lock.release();
+	}
+
+	#endif
 }
\ No newline at end of file
@@ -1,12 +1,32 @@
 #pragma once
 
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+#pragma region
+
+// The Win32 backend is used by default on Windows. Define
+// SMALLPT_STD_THREADS to use the portable C++ standard library backend
+// (which is always used on other platforms).
+#if defined(_WIN32) && !defined(SMALLPT_STD_THREADS)
+	#define SMALLPT_WIN32_THREADS
+#endif
+
+#pragma endregion
+
 //-----------------------------------------------------------------------------
 // System Includes
 //-----------------------------------------------------------------------------
 #pragma region
 
 #include <cstdint>
-#include "windows.hpp"
+
+#ifdef SMALLPT_WIN32_THREADS
+	#include "windows.hpp"
+#else
+	#include <condition_variable>
+	#include <mutex>
+#endif
 
 #pragma endregion
 
@@ -84,10 +104,21 @@ namespace smallpt {
 		// Member Variables
 		//---------------------------------------------------------------------
 
+		#ifdef SMALLPT_WIN32_THREADS
+
 		/**
 		 The critical section object of this mutex.
 		 */
 		CRITICAL_SECTION m_critical_section;
+
+		#else
+
+		/**
+		 The mutex object of this mutex.
+		 */
+		std::mutex m_mutex;
+
+		#endif
 	};
 
 	/**
@@ -265,10 +296,32 @@ namespace smallpt {
 		// Member Variables
 		//---------------------------------------------------------------------
 
+		#ifdef SMALLPT_WIN32_THREADS
+
 		/**
 		 The handle of this semaphore.
 		 */
 		HANDLE m_handle;
+
+		#else
+
+		/**
+		 The count of this semaphore.
+		 */
+		std::uint32_t m_count;
+
+		/**
+		 The mutex guarding @c m_count of this semaphore.
+		 */
+		std::mutex m_mutex;
+
+		/**
+		 The condition variable signalled when @c m_count of this semaphore
+		 is increased.
+		 */
+		std::condition_variable m_condition;
+
+		#endif
 	};
 
 	/**
@@ -362,6 +415,8 @@ namespace smallpt {
 		// Member Variables
 		//---------------------------------------------------------------------
 
+		#ifdef SMALLPT_WIN32_THREADS
+
 		/** 
 		 The number of waiters of this condition variable.
 		 */
@@ -392,5 +447,19 @@ namespace smallpt {
 		 The signal and broadcast event handles of this condition variable.
 		 */
 		HANDLE m_events[COUNT];
+
+		#else
+
+		/**
+		 The mutex guarding the condition of this condition variable.
+		 */
+		std::mutex m_condition_mutex;
+
+		/**
+		 The condition variable of this condition variable.
+		 */
+		std::condition_variable m_condition;
+
+		#endif
 	};
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "rng.hpp"
+#include "sphere.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Particles
+	//-------------------------------------------------------------------------
+
+	// The box in the middle of the Cornell box the particles are placed in.
+	constexpr Vector3 g_particles_min = { 10.0, 5.0, 30.0 };
+	constexpr Vector3 g_particles_max = { 90.0, 75.0, 120.0 };
+
+	// Appends nb_particles small diffuse spheres, uniformly distributed over
+	// the middle of the Cornell box, as a stand-in for particle and point
+	// cloud data. The radius shrinks with the number of particles, so the
+	// cloud covers about the same part of the image for any count.
+	inline void AddParticles(std::vector< Sphere >& spheres,
+							 std::size_t nb_particles,
+							 std::uint32_t seed = g_default_seed) {
+		if (0u == nb_particles) {
+			return;
+		}
+
+		const Vector3 extent = g_particles_max - g_particles_min;
+		const double spacing = std::cbrt(extent.m_x * extent.m_y * extent.m_z / nb_particles);
+		const double r = 0.25 * spacing;
+
+		RNG rng(seed);
+		spheres.reserve(spheres.size() + nb_particles);
+		for (std::size_t i = 0u; i < nb_particles; ++i) {
+			const Vector3 p = g_particles_min + extent * Vector3(rng.Uniform(), rng.Uniform(), rng.Uniform());
+			const Vector3 f = Vector3(0.25) + 0.7 * Vector3(rng.Uniform(), rng.Uniform(), rng.Uniform());
+			spheres.emplace_back(r, p, Vector3(), f, Reflection_t::Diffuse);
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: ParticleAnimation
+	//-------------------------------------------------------------------------
+
+	// A stand-in for simulation output: every frame, each particle moves by
+	// its own constant velocity (of at most max_speed per axis) and bounces 
+	// off the faces of the particle box. The number of spheres is unchanged.
+	class ParticleAnimation {
+
+	public:
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		explicit ParticleAnimation(std::size_t first_particle,
+								   std::size_t nb_particles,
+								   double max_speed = 0.25,
+								   std::uint32_t seed = g_default_seed + 1u)
+			: m_first_particle(first_particle),
+			m_velocities() {
+
+			RNG rng(seed);
+			m_velocities.reserve(nb_particles);
+			for (std::size_t i = 0u; i < nb_particles; ++i) {
+				m_velocities.push_back(max_speed * Vector3(2.0 * rng.Uniform() - 1.0, 
+														   2.0 * rng.Uniform() - 1.0, 
+														   2.0 * rng.Uniform() - 1.0));
+			}
+		}
+		ParticleAnimation(const ParticleAnimation& animation) = default;
+		ParticleAnimation(ParticleAnimation&& animation) noexcept = default;
+		~ParticleAnimation() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		ParticleAnimation& operator=(const ParticleAnimation& animation) = default;
+		ParticleAnimation& operator=(ParticleAnimation&& animation) noexcept = default;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		void Step(std::vector< Sphere >& spheres) noexcept {
+			for (std::size_t i = 0u; i < m_velocities.size(); ++i) {
+				Vector3& p = spheres[m_first_particle + i].m_p;
+				Vector3& v = m_velocities[i];
+				p += v;
+				for (std::size_t a = 0u; a < 3u; ++a) {
+					if (p[a] < g_particles_min[a] || g_particles_max[a] < p[a]) {
+						p[a] = std::clamp(p[a], g_particles_min[a], g_particles_max[a]);
+						v[a] = -v[a];
+					}
+				}
+			}
+		}
+
+	private:
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		std::size_t m_first_particle;
+		std::vector< Vector3 > m_velocities;
+	};
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "tile.hpp"
+#include "vector.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: RunningVariance
+	//-------------------------------------------------------------------------
+
+	// The mean and variance of a sequence of values, updated one value at a
+	// time (Welford's algorithm, which does not suffer from the cancellation
+	// of accumulating the sum of squares).
+	struct RunningVariance {
+
+		void Add(double x) noexcept {
+			++m_n;
+			const double delta = x - m_mean;
+			m_mean += delta / m_n;
+			m_m2   += delta * (x - m_mean);
+		}
+
+		// The unbiased sample variance.
+		[[nodiscard]]
+		double GetVariance() const noexcept {
+			return (1u < m_n) ? m_m2 / (m_n - 1u) : 0.0;
+		}
+
+		std::uint32_t m_n = 0u;
+		double m_mean     = 0.0;
+		double m_m2       = 0.0; // sum of squared differences from the mean
+	};
+
+	// The luminance (Rec. 709) of a linear RGB radiance.
+	[[nodiscard]]
+	constexpr double Luminance(const Vector3& L) noexcept {
+		return 0.2126 * L.m_x + 0.7152 * L.m_y + 0.0722 * L.m_z;
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: PixelStatistics
+	//-------------------------------------------------------------------------
+
+	// The number of samples of every pixel, and the mean and variance of their
+	// clamped luminance. Each pixel is only accessed by whoever renders it.
+	class PixelStatistics {
+
+	public:
+
+		//---------------------------------------------------------------------
+		// Class Member Variables
+		//---------------------------------------------------------------------
+
+		// The mean below which pixels count as dark, which need not be as
+		// accurate relative to it.
+		static constexpr double g_min_mean = 0.05;
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		explicit PixelStatistics(std::size_t nb_pixels)
+			: m_pixels(nb_pixels) {}
+		PixelStatistics(const PixelStatistics& statistics) = default;
+		PixelStatistics(PixelStatistics&& statistics) noexcept = default;
+		~PixelStatistics() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		PixelStatistics& operator=(const PixelStatistics& statistics) = default;
+		PixelStatistics& operator=(PixelStatistics&& statistics) noexcept = default;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		// Adds the radiance of a sample of (any subpixel of) pixel i.
+		void Add(std::size_t i, const Vector3& L) noexcept {
+			m_pixels[i].Add(Luminance(Clamp(L)));
+		}
+
+		[[nodiscard]]
+		std::size_t GetNumberOfPixels() const noexcept {
+			return m_pixels.size();
+		}
+
+		// The number of samples per pixel of every pixel.
+		[[nodiscard]]
+		const std::vector< std::uint32_t > GetSampleCounts() const {
+			std::vector< std::uint32_t > counts(m_pixels.size());
+			for (std::size_t i = 0u; i < m_pixels.size(); ++i) {
+				counts[i] = m_pixels[i].m_n;
+			}
+			return counts;
+		}
+
+		// The estimated error of the mean of pixel i, relative to it.
+		[[nodiscard]]
+		double GetRelativeError(std::size_t i) const noexcept {
+			const RunningVariance& pixel = m_pixels[i];
+			if (0u == pixel.m_n) {
+				return 0.0;
+			}
+			return std::sqrt(pixel.GetVariance() / pixel.m_n) / std::max(pixel.m_mean, g_min_mean);
+		}
+
+	private:
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		std::vector< RunningVariance > m_pixels;
+	};
+
+	// Prints the minimum, mean and maximum number of samples per pixel, and
+	// the spread of the relative errors of the pixels. The narrower it is,
+	// the less sampling some pixels more than others can gain.
+	inline void PrintPixelStatistics(const PixelStatistics& statistics) {
+		const std::size_t nb_pixels = statistics.GetNumberOfPixels();
+		if (0u == nb_pixels) {
+			return;
+		}
+
+		const std::vector< std::uint32_t > counts = statistics.GetSampleCounts();
+		const auto [min_count, max_count] = std::minmax_element(counts.cbegin(), counts.cend());
+		double total_count = 0.0;
+		for (const std::uint32_t count : counts) {
+			total_count += count;
+		}
+
+		std::vector< double > errors(nb_pixels);
+		for (std::size_t i = 0u; i < nb_pixels; ++i) {
+			errors[i] = statistics.GetRelativeError(i);
+		}
+		std::sort(errors.begin(), errors.end());
+
+		std::fprintf(stderr, "Pixels: spp min %u, mean %.1f, max %u; relative error p10 %.3f, p50 %.3f, p90 %.3f, p99 %.3f\n",
+					 *min_count, total_count / nb_pixels, *max_count,
+					 errors[nb_pixels / 10u], errors[nb_pixels / 2u],
+					 errors[9u * nb_pixels / 10u], errors[99u * nb_pixels / 100u]);
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Adaptive Sampling
+	//-------------------------------------------------------------------------
+
+	// The default maximum relative error of a tile (see UpdateActiveTiles).
+	constexpr double g_default_max_relative_error = 0.1;
+
+	// The number of samples per subpixel of the first pass of an adaptive 
+	// render, which every tile takes part in.
+	constexpr std::uint32_t g_nb_adaptive_base_samples = 4u;
+
+	// The RMS of the relative errors of the pixels of a tile of a w x h image
+	// (whose rows are stored bottom-up).
+	[[nodiscard]]
+	inline double GetRelativeError(const PixelStatistics& statistics, 
+								   const Tile& tile, 
+								   std::uint32_t w, 
+								   std::uint32_t h) noexcept {
+		double sum = 0.0;
+		for (std::size_t y = tile.m_y0; y < tile.m_y1; ++y) { // pixel row
+			for (std::size_t x = tile.m_x0; x < tile.m_x1; ++x) { // pixel column
+				const double error = statistics.GetRelativeError((h - 1u - y) * w + x);
+				sum += error * error;
+			}
+		}
+		const std::size_t nb_pixels = std::size_t(tile.m_x1 - tile.m_x0) * (tile.m_y1 - tile.m_y0);
+		return std::sqrt(sum / nb_pixels);
+	}
+
+	// Keeps the active tiles whose relative error still exceeds 
+	// max_relative_error in the next pass of an adaptive render, and returns
+	// how many remain. A tile that stopped does not take part again: without
+	// new samples, its error does not change.
+	inline std::size_t UpdateActiveTiles(const PixelStatistics& statistics, 
+										 const std::vector< Tile >& tiles, 
+										 std::uint32_t w, 
+										 std::uint32_t h, 
+										 double max_relative_error, 
+										 std::vector< bool >& active_tiles) noexcept {
+		std::size_t nb_active_tiles = 0u;
+		for (std::size_t t = 0u; t < tiles.size(); ++t) { // tile
+			if (active_tiles[t]) {
+				active_tiles[t] = max_relative_error < GetRelativeError(statistics, tiles[t], w, h);
+				nb_active_tiles += active_tiles[t] ? 1u : 0u;
+			}
+		}
+		return nb_active_tiles;
+	}
+}
@@ -14,13 +14,14 @@
 //-----------------------------------------------------------------------------
 namespace smallpt {
 
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 UniformSampleOnSphere(double u1, 
-											   double u2) noexcept {
+	inline const BasicVector3< T > UniformSampleOnSphere(T u1, 
+														 T u2) noexcept {
 		
-		const double cos_theta = 1.0 - 2.0 * u1;
-		const double sin_theta = std::sqrt(std::max(0.0, 1.0 - cos_theta * cos_theta));
-		const double phi = 2.0 * g_pi * u2;
+		const T cos_theta = T(1) - T(2) * u1;
+		const T sin_theta = std::sqrt(std::max(T(0), T(1) - cos_theta * cos_theta));
+		const T phi = T(2 * g_pi) * u2;
 		return { 
 			std::cos(phi) * sin_theta, 
 			std::sin(phi) * sin_theta, 
@@ -28,13 +29,14 @@ namespace smallpt {
 		};
 	}
 
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 UniformSampleOnHemisphere(double u1, 
-												   double u2) noexcept {
+	inline const BasicVector3< T > UniformSampleOnHemisphere(T u1, 
+															 T u2) noexcept {
 		
 		// u1 := cos_theta
-		const double sin_theta = std::sqrt(std::max(0.0, 1.0 - u1 * u1));
-		const double phi = 2.0 * g_pi * u2;
+		const T sin_theta = std::sqrt(std::max(T(0), T(1) - u1 * u1));
+		const T phi = T(2 * g_pi) * u2;
 		return { 
 			std::cos(phi) * sin_theta, 
 			std::sin(phi) * sin_theta, 
@@ -42,17 +44,68 @@ namespace smallpt {
 		};
 	}
 
+	// A direction uniformly distributed over the solid angle of the cone of
+	// the given half angle around the z axis (and one_minus_cos_theta_max,
+	// 1 - cos_theta_max, computed without cancellation for narrow cones).
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 CosineWeightedSampleOnHemisphere(double u1, 
-														  double u2) noexcept {
+	inline const BasicVector3< T > UniformSampleInCone(T u1, 
+													   T u2, 
+													   T one_minus_cos_theta_max) noexcept {
 		
-		const double cos_theta = sqrt(1.0 - u1);
-		const double sin_theta = sqrt(u1);
-		const double phi = 2.0 * g_pi * u2;
+		const T cos_theta = T(1) - u1 * one_minus_cos_theta_max;
+		const T sin_theta = std::sqrt(std::max(T(0), T(1) - cos_theta * cos_theta));
+		const T phi = T(2 * g_pi) * u2;
 		return { 
 			std::cos(phi) * sin_theta, 
 			std::sin(phi) * sin_theta, 
 			cos_theta 
 		};
 	}
+
+	template< typename T >
+	[[nodiscard]]
+	constexpr T UniformConePdf(T one_minus_cos_theta_max) noexcept {
+		return T(1) / (T(2 * g_pi) * one_minus_cos_theta_max);
+	}
+
+	template< typename T >
+	[[nodiscard]]
+	inline const BasicVector3< T > CosineWeightedSampleOnHemisphere(T u1, 
+																	T u2) noexcept {
+		
+		const T cos_theta = std::sqrt(T(1) - u1);
+		const T sin_theta = std::sqrt(u1);
+		const T phi = T(2 * g_pi) * u2;
+		return { 
+			std::cos(phi) * sin_theta, 
+			std::sin(phi) * sin_theta, 
+			cos_theta 
+		};
+	}
+
+	// The density per unit solid angle of CosineWeightedSampleOnHemisphere
+	// for a direction at angle theta from the z axis.
+	template< typename T >
+	[[nodiscard]]
+	constexpr T CosineWeightedHemispherePdf(T cos_theta) noexcept {
+		return std::max(T(0), cos_theta) / T(g_pi);
+	}
+
+	// The weight of a sample of strategy f, drawn with density pdf_f, given
+	// the density pdf_g of the same sample under the other strategy g (one 
+	// sample each). The weights of f and g for the same sample sum to 1.
+	template< typename T >
+	[[nodiscard]]
+	constexpr T BalanceHeuristic(T pdf_f, T pdf_g) noexcept {
+		return (T(0) < pdf_f) ? pdf_f / (pdf_f + pdf_g) : T(0);
+	}
+
+	// See BalanceHeuristic. Lowers the weight of the strategy with the lower
+	// density further, removing more of the variance it causes.
+	template< typename T >
+	[[nodiscard]]
+	constexpr T PowerHeuristic(T pdf_f, T pdf_g) noexcept {
+		return (T(0) < pdf_f) ? pdf_f * pdf_f / (pdf_f * pdf_f + pdf_g * pdf_g) : T(0);
+	}
 }
\ No newline at end of file
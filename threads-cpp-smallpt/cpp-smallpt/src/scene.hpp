@@ -0,0 +1,1101 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "box.hpp"
+#include "bvh.hpp"
+#include "wide_bvh.hpp"
+#include "packet.hpp"
+#include "plane.hpp"
+#include "simd.hpp"
+#include "sphere.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Material
+	//-------------------------------------------------------------------------
+
+	struct Material {
+		Vector3 m_e; // emission
+		Vector3 m_f; // reflection
+		Reflection_t m_reflection_t;
+	};
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: SphereSoA
+	//-------------------------------------------------------------------------
+
+	// Spheres stored as a structure of arrays, so the intersection kernels
+	// load the same attribute of consecutive spheres with a single instruction.
+	struct SphereSoA {
+
+		[[nodiscard]]
+		std::size_t size() const noexcept {
+			return m_r2.size();
+		}
+
+		void push_back(const Sphere& sphere) {
+			m_px.push_back(sphere.m_p.m_x);
+			m_py.push_back(sphere.m_p.m_y);
+			m_pz.push_back(sphere.m_p.m_z);
+			m_r2.push_back(sphere.m_r * sphere.m_r);
+			m_materials.push_back({ sphere.m_e, sphere.m_f, sphere.m_reflection_t });
+		}
+
+		void resize(std::size_t size) {
+			m_px.resize(size);
+			m_py.resize(size);
+			m_pz.resize(size);
+			m_r2.resize(size);
+			m_materials.resize(size);
+		}
+
+		void Set(std::size_t i, const Sphere& sphere) noexcept {
+			m_px[i] = sphere.m_p.m_x;
+			m_py[i] = sphere.m_p.m_y;
+			m_pz[i] = sphere.m_p.m_z;
+			m_r2[i] = sphere.m_r * sphere.m_r;
+			m_materials[i] = { sphere.m_e, sphere.m_f, sphere.m_reflection_t };
+		}
+
+		std::vector< double > m_px, m_py, m_pz; // centers
+		std::vector< double > m_r2;             // radii squared
+		std::vector< Material > m_materials;
+	};
+
+	//-------------------------------------------------------------------------
+	// Intersection Kernels
+	//-------------------------------------------------------------------------
+
+	// Intersects the ray with the spheres [begin, end). If the closest hit lies
+	// within (ray.m_tmin, ray.m_tmax), stores its index in hit, sets ray.m_tmax
+	// to its distance and returns true (the contract of Sphere::Intersect).
+	using IntersectKernel = bool (*)(const SphereSoA& spheres,
+									 std::size_t begin,
+									 std::size_t end,
+									 const Ray& ray,
+									 std::size_t& hit) noexcept;
+
+	[[nodiscard]]
+	inline bool IntersectSpheresScalar(const SphereSoA& spheres,
+									   std::size_t begin,
+									   std::size_t end,
+									   const Ray& ray,
+									   std::size_t& hit) noexcept {
+		bool found = false;
+		for (std::size_t i = begin; i < end; ++i) {
+			// See Sphere::Intersect.
+			const double opx = spheres.m_px[i] - ray.m_o.m_x;
+			const double opy = spheres.m_py[i] - ray.m_o.m_y;
+			const double opz = spheres.m_pz[i] - ray.m_o.m_z;
+			const double dop = ray.m_d.m_x * opx + ray.m_d.m_y * opy + ray.m_d.m_z * opz;
+			const double D = dop * dop - (opx * opx + opy * opy + opz * opz) + spheres.m_r2[i];
+
+			if (0.0 > D) {
+				continue;
+			}
+
+			const double sqrtD = std::sqrt(D);
+
+			const double tmin = dop - sqrtD;
+			if (ray.m_tmin < tmin && tmin < ray.m_tmax) {
+				ray.m_tmax = tmin;
+				hit = i;
+				found = true;
+				continue;
+			}
+
+			const double tmax = dop + sqrtD;
+			if (ray.m_tmin < tmax && tmax < ray.m_tmax) {
+				ray.m_tmax = tmax;
+				hit = i;
+				found = true;
+			}
+		}
+
+		return found;
+	}
+
+	#ifdef SMALLPT_X86
+
+	// Each kernel computes the distance of the nearest valid intersection of
+	// every lane (infinity if none), reduces it with a horizontal min and only
+	// then compares against ray.m_tmax. A negative discriminant yields a NaN
+	// square root, which fails every (ordered) comparison.
+
+	[[nodiscard]]
+	SMALLPT_TARGET("sse2")
+	inline bool IntersectSpheresSSE2(const SphereSoA& spheres,
+									 std::size_t begin,
+									 std::size_t end,
+									 const Ray& ray,
+									 std::size_t& hit) noexcept {
+		const __m128d ox = _mm_set1_pd(ray.m_o.m_x);
+		const __m128d oy = _mm_set1_pd(ray.m_o.m_y);
+		const __m128d oz = _mm_set1_pd(ray.m_o.m_z);
+		const __m128d dx = _mm_set1_pd(ray.m_d.m_x);
+		const __m128d dy = _mm_set1_pd(ray.m_d.m_y);
+		const __m128d dz = _mm_set1_pd(ray.m_d.m_z);
+		const __m128d tmin = _mm_set1_pd(ray.m_tmin);
+		const __m128d inf  = _mm_set1_pd(std::numeric_limits< double >::infinity());
+		__m128d tmax = _mm_set1_pd(ray.m_tmax);
+
+		bool found = false;
+		std::size_t i = begin;
+		for (; i + 2u <= end; i += 2u) {
+			const __m128d opx = _mm_sub_pd(_mm_loadu_pd(&spheres.m_px[i]), ox);
+			const __m128d opy = _mm_sub_pd(_mm_loadu_pd(&spheres.m_py[i]), oy);
+			const __m128d opz = _mm_sub_pd(_mm_loadu_pd(&spheres.m_pz[i]), oz);
+			const __m128d dop = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, opx), _mm_mul_pd(dy, opy)), _mm_mul_pd(dz, opz));
+			const __m128d opop = _mm_add_pd(_mm_add_pd(_mm_mul_pd(opx, opx), _mm_mul_pd(opy, opy)), _mm_mul_pd(opz, opz));
+			const __m128d D = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(dop, dop), opop), _mm_loadu_pd(&spheres.m_r2[i]));
+			const __m128d sqrtD = _mm_sqrt_pd(D);
+
+			const __m128d t0 = _mm_sub_pd(dop, sqrtD);
+			const __m128d t1 = _mm_add_pd(dop, sqrtD);
+			const __m128d valid0 = _mm_and_pd(_mm_cmplt_pd(tmin, t0), _mm_cmplt_pd(t0, tmax));
+			const __m128d valid1 = _mm_and_pd(_mm_cmplt_pd(tmin, t1), _mm_cmplt_pd(t1, tmax));
+			__m128d t = _mm_or_pd(_mm_and_pd(valid1, t1), _mm_andnot_pd(valid1, inf));
+			t = _mm_or_pd(_mm_and_pd(valid0, t0), _mm_andnot_pd(valid0, t));
+
+			const __m128d t_min = _mm_min_pd(t, _mm_shuffle_pd(t, t, 0x1));
+			const double t_hit = _mm_cvtsd_f64(t_min);
+			if (t_hit < ray.m_tmax) {
+				const int lanes = _mm_movemask_pd(_mm_cmpeq_pd(t, t_min));
+				hit = i + static_cast< std::size_t >(std::countr_zero(static_cast< unsigned int >(lanes)));
+				ray.m_tmax = t_hit;
+				tmax = t_min;
+				found = true;
+			}
+		}
+
+		std::size_t tail_hit;
+		if (IntersectSpheresScalar(spheres, i, end, ray, tail_hit)) {
+			hit = tail_hit;
+			found = true;
+		}
+
+		return found;
+	}
+
+	[[nodiscard]]
+	SMALLPT_TARGET("avx2")
+	inline bool IntersectSpheresAVX2(const SphereSoA& spheres,
+									 std::size_t begin,
+									 std::size_t end,
+									 const Ray& ray,
+									 std::size_t& hit) noexcept {
+		const __m256d ox = _mm256_set1_pd(ray.m_o.m_x);
+		const __m256d oy = _mm256_set1_pd(ray.m_o.m_y);
+		const __m256d oz = _mm256_set1_pd(ray.m_o.m_z);
+		const __m256d dx = _mm256_set1_pd(ray.m_d.m_x);
+		const __m256d dy = _mm256_set1_pd(ray.m_d.m_y);
+		const __m256d dz = _mm256_set1_pd(ray.m_d.m_z);
+		const __m256d tmin = _mm256_set1_pd(ray.m_tmin);
+		const __m256d inf  = _mm256_set1_pd(std::numeric_limits< double >::infinity());
+		__m256d tmax = _mm256_set1_pd(ray.m_tmax);
+
+		bool found = false;
+		std::size_t i = begin;
+		for (; i + 4u <= end; i += 4u) {
+			const __m256d opx = _mm256_sub_pd(_mm256_loadu_pd(&spheres.m_px[i]), ox);
+			const __m256d opy = _mm256_sub_pd(_mm256_loadu_pd(&spheres.m_py[i]), oy);
+			const __m256d opz = _mm256_sub_pd(_mm256_loadu_pd(&spheres.m_pz[i]), oz);
+			const __m256d dop = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, opx), _mm256_mul_pd(dy, opy)), _mm256_mul_pd(dz, opz));
+			const __m256d opop = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(opx, opx), _mm256_mul_pd(opy, opy)), _mm256_mul_pd(opz, opz));
+			const __m256d D = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(dop, dop), opop), _mm256_loadu_pd(&spheres.m_r2[i]));
+			const __m256d sqrtD = _mm256_sqrt_pd(D);
+
+			const __m256d t0 = _mm256_sub_pd(dop, sqrtD);
+			const __m256d t1 = _mm256_add_pd(dop, sqrtD);
+			const __m256d valid0 = _mm256_and_pd(_mm256_cmp_pd(tmin, t0, _CMP_LT_OQ), _mm256_cmp_pd(t0, tmax, _CMP_LT_OQ));
+			const __m256d valid1 = _mm256_and_pd(_mm256_cmp_pd(tmin, t1, _CMP_LT_OQ), _mm256_cmp_pd(t1, tmax, _CMP_LT_OQ));
+			__m256d t = _mm256_blendv_pd(inf, t1, valid1);
+			t = _mm256_blendv_pd(t, t0, valid0);
+
+			__m256d t_min = _mm256_min_pd(t, _mm256_permute2f128_pd(t, t, 0x1));
+			t_min = _mm256_min_pd(t_min, _mm256_shuffle_pd(t_min, t_min, 0x5));
+			const double t_hit = _mm256_cvtsd_f64(t_min);
+			if (t_hit < ray.m_tmax) {
+				const int lanes = _mm256_movemask_pd(_mm256_cmp_pd(t, t_min, _CMP_EQ_OQ));
+				hit = i + static_cast< std::size_t >(std::countr_zero(static_cast< unsigned int >(lanes)));
+				ray.m_tmax = t_hit;
+				tmax = t_min;
+				found = true;
+			}
+		}
+
+		std::size_t tail_hit;
+		if (IntersectSpheresScalar(spheres, i, end, ray, tail_hit)) {
+			hit = tail_hit;
+			found = true;
+		}
+
+		return found;
+	}
+
+	SMALLPT_BEGIN_AVX512_KERNELS
+
+	[[nodiscard]]
+	SMALLPT_TARGET("avx512f")
+	inline bool IntersectSpheresAVX512(const SphereSoA& spheres,
+									   std::size_t begin,
+									   std::size_t end,
+									   const Ray& ray,
+									   std::size_t& hit) noexcept {
+		const __m512d ox = _mm512_set1_pd(ray.m_o.m_x);
+		const __m512d oy = _mm512_set1_pd(ray.m_o.m_y);
+		const __m512d oz = _mm512_set1_pd(ray.m_o.m_z);
+		const __m512d dx = _mm512_set1_pd(ray.m_d.m_x);
+		const __m512d dy = _mm512_set1_pd(ray.m_d.m_y);
+		const __m512d dz = _mm512_set1_pd(ray.m_d.m_z);
+		const __m512d tmin = _mm512_set1_pd(ray.m_tmin);
+		const __m512d inf  = _mm512_set1_pd(std::numeric_limits< double >::infinity());
+		__m512d tmax = _mm512_set1_pd(ray.m_tmax);
+
+		bool found = false;
+		// The tail is handled by masking off the lanes past end.
+		for (std::size_t i = begin; i < end; i += 8u) {
+			const __mmask8 lanes = (8u <= end - i) ? __mmask8(0xFF) : __mmask8((1u << (end - i)) - 1u);
+
+			const __m512d opx = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, &spheres.m_px[i]), ox);
+			const __m512d opy = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, &spheres.m_py[i]), oy);
+			const __m512d opz = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, &spheres.m_pz[i]), oz);
+			const __m512d dop = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, opx), _mm512_mul_pd(dy, opy)), _mm512_mul_pd(dz, opz));
+			const __m512d opop = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(opx, opx), _mm512_mul_pd(opy, opy)), _mm512_mul_pd(opz, opz));
+			const __m512d D = _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(dop, dop), opop), _mm512_maskz_loadu_pd(lanes, &spheres.m_r2[i]));
+			const __m512d sqrtD = _mm512_sqrt_pd(D);
+
+			const __m512d t0 = _mm512_sub_pd(dop, sqrtD);
+			const __m512d t1 = _mm512_add_pd(dop, sqrtD);
+			const __mmask8 valid0 = lanes & _mm512_cmp_pd_mask(tmin, t0, _CMP_LT_OQ) & _mm512_cmp_pd_mask(t0, tmax, _CMP_LT_OQ);
+			const __mmask8 valid1 = lanes & _mm512_cmp_pd_mask(tmin, t1, _CMP_LT_OQ) & _mm512_cmp_pd_mask(t1, tmax, _CMP_LT_OQ);
+			__m512d t = _mm512_mask_blend_pd(valid1, inf, t1);
+			t = _mm512_mask_blend_pd(valid0, t, t0);
+
+			const double t_hit = _mm512_reduce_min_pd(t);
+			if (t_hit < ray.m_tmax) {
+				tmax = _mm512_set1_pd(t_hit);
+				const unsigned int hit_lanes = _mm512_cmp_pd_mask(t, tmax, _CMP_EQ_OQ);
+				hit = i + static_cast< std::size_t >(std::countr_zero(hit_lanes));
+				ray.m_tmax = t_hit;
+				found = true;
+			}
+		}
+
+		return found;
+	}
+
+	SMALLPT_END_AVX512_KERNELS
+
+	#endif
+
+	//-------------------------------------------------------------------------
+	// Occlusion Kernels
+	//-------------------------------------------------------------------------
+
+	// Returns whether the ray hits any of the spheres [begin, end) within 
+	// (ray.m_tmin, ray.m_tmax), stopping at the first hit found. Unlike an 
+	// IntersectKernel, it neither narrows ray.m_tmax nor records the hit.
+	using OccludedKernel = bool (*)(const SphereSoA& spheres,
+									std::size_t begin,
+									std::size_t end,
+									const Ray& ray) noexcept;
+
+	[[nodiscard]]
+	inline bool OccludedSpheresScalar(const SphereSoA& spheres,
+									  std::size_t begin,
+									  std::size_t end,
+									  const Ray& ray) noexcept {
+		for (std::size_t i = begin; i < end; ++i) {
+			// See Sphere::Intersect.
+			const double opx = spheres.m_px[i] - ray.m_o.m_x;
+			const double opy = spheres.m_py[i] - ray.m_o.m_y;
+			const double opz = spheres.m_pz[i] - ray.m_o.m_z;
+			const double dop = ray.m_d.m_x * opx + ray.m_d.m_y * opy + ray.m_d.m_z * opz;
+			const double D = dop * dop - (opx * opx + opy * opy + opz * opz) + spheres.m_r2[i];
+
+			if (0.0 > D) {
+				continue;
+			}
+
+			const double sqrtD = std::sqrt(D);
+
+			const double tmin = dop - sqrtD;
+			const double tmax = dop + sqrtD;
+			if ((ray.m_tmin < tmin && tmin < ray.m_tmax) 
+				|| (ray.m_tmin < tmax && tmax < ray.m_tmax)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	#ifdef SMALLPT_X86
+
+	// Each kernel only tests whether any lane has a valid intersection, so
+	// there is no horizontal reduction (see the intersection kernels for the
+	// handling of negative discriminants).
+
+	[[nodiscard]]
+	SMALLPT_TARGET("sse2")
+	inline bool OccludedSpheresSSE2(const SphereSoA& spheres,
+									std::size_t begin,
+									std::size_t end,
+									const Ray& ray) noexcept {
+		const __m128d ox = _mm_set1_pd(ray.m_o.m_x);
+		const __m128d oy = _mm_set1_pd(ray.m_o.m_y);
+		const __m128d oz = _mm_set1_pd(ray.m_o.m_z);
+		const __m128d dx = _mm_set1_pd(ray.m_d.m_x);
+		const __m128d dy = _mm_set1_pd(ray.m_d.m_y);
+		const __m128d dz = _mm_set1_pd(ray.m_d.m_z);
+		const __m128d tmin = _mm_set1_pd(ray.m_tmin);
+		const __m128d tmax = _mm_set1_pd(ray.m_tmax);
+
+		std::size_t i = begin;
+		for (; i + 2u <= end; i += 2u) {
+			const __m128d opx = _mm_sub_pd(_mm_loadu_pd(&spheres.m_px[i]), ox);
+			const __m128d opy = _mm_sub_pd(_mm_loadu_pd(&spheres.m_py[i]), oy);
+			const __m128d opz = _mm_sub_pd(_mm_loadu_pd(&spheres.m_pz[i]), oz);
+			const __m128d dop = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, opx), _mm_mul_pd(dy, opy)), _mm_mul_pd(dz, opz));
+			const __m128d opop = _mm_add_pd(_mm_add_pd(_mm_mul_pd(opx, opx), _mm_mul_pd(opy, opy)), _mm_mul_pd(opz, opz));
+			const __m128d D = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(dop, dop), opop), _mm_loadu_pd(&spheres.m_r2[i]));
+			const __m128d sqrtD = _mm_sqrt_pd(D);
+
+			const __m128d t0 = _mm_sub_pd(dop, sqrtD);
+			const __m128d t1 = _mm_add_pd(dop, sqrtD);
+			const __m128d valid0 = _mm_and_pd(_mm_cmplt_pd(tmin, t0), _mm_cmplt_pd(t0, tmax));
+			const __m128d valid1 = _mm_and_pd(_mm_cmplt_pd(tmin, t1), _mm_cmplt_pd(t1, tmax));
+			if (0 != _mm_movemask_pd(_mm_or_pd(valid0, valid1))) {
+				return true;
+			}
+		}
+
+		return OccludedSpheresScalar(spheres, i, end, ray);
+	}
+
+	[[nodiscard]]
+	SMALLPT_TARGET("avx2")
+	inline bool OccludedSpheresAVX2(const SphereSoA& spheres,
+									std::size_t begin,
+									std::size_t end,
+									const Ray& ray) noexcept {
+		const __m256d ox = _mm256_set1_pd(ray.m_o.m_x);
+		const __m256d oy = _mm256_set1_pd(ray.m_o.m_y);
+		const __m256d oz = _mm256_set1_pd(ray.m_o.m_z);
+		const __m256d dx = _mm256_set1_pd(ray.m_d.m_x);
+		const __m256d dy = _mm256_set1_pd(ray.m_d.m_y);
+		const __m256d dz = _mm256_set1_pd(ray.m_d.m_z);
+		const __m256d tmin = _mm256_set1_pd(ray.m_tmin);
+		const __m256d tmax = _mm256_set1_pd(ray.m_tmax);
+
+		std::size_t i = begin;
+		for (; i + 4u <= end; i += 4u) {
+			const __m256d opx = _mm256_sub_pd(_mm256_loadu_pd(&spheres.m_px[i]), ox);
+			const __m256d opy = _mm256_sub_pd(_mm256_loadu_pd(&spheres.m_py[i]), oy);
+			const __m256d opz = _mm256_sub_pd(_mm256_loadu_pd(&spheres.m_pz[i]), oz);
+			const __m256d dop = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, opx), _mm256_mul_pd(dy, opy)), _mm256_mul_pd(dz, opz));
+			const __m256d opop = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(opx, opx), _mm256_mul_pd(opy, opy)), _mm256_mul_pd(opz, opz));
+			const __m256d D = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(dop, dop), opop), _mm256_loadu_pd(&spheres.m_r2[i]));
+			const __m256d sqrtD = _mm256_sqrt_pd(D);
+
+			const __m256d t0 = _mm256_sub_pd(dop, sqrtD);
+			const __m256d t1 = _mm256_add_pd(dop, sqrtD);
+			const __m256d valid0 = _mm256_and_pd(_mm256_cmp_pd(tmin, t0, _CMP_LT_OQ), _mm256_cmp_pd(t0, tmax, _CMP_LT_OQ));
+			const __m256d valid1 = _mm256_and_pd(_mm256_cmp_pd(tmin, t1, _CMP_LT_OQ), _mm256_cmp_pd(t1, tmax, _CMP_LT_OQ));
+			if (0 != _mm256_movemask_pd(_mm256_or_pd(valid0, valid1))) {
+				return true;
+			}
+		}
+
+		return OccludedSpheresScalar(spheres, i, end, ray);
+	}
+
+	SMALLPT_BEGIN_AVX512_KERNELS
+
+	[[nodiscard]]
+	SMALLPT_TARGET("avx512f")
+	inline bool OccludedSpheresAVX512(const SphereSoA& spheres,
+									  std::size_t begin,
+									  std::size_t end,
+									  const Ray& ray) noexcept {
+		const __m512d ox = _mm512_set1_pd(ray.m_o.m_x);
+		const __m512d oy = _mm512_set1_pd(ray.m_o.m_y);
+		const __m512d oz = _mm512_set1_pd(ray.m_o.m_z);
+		const __m512d dx = _mm512_set1_pd(ray.m_d.m_x);
+		const __m512d dy = _mm512_set1_pd(ray.m_d.m_y);
+		const __m512d dz = _mm512_set1_pd(ray.m_d.m_z);
+		const __m512d tmin = _mm512_set1_pd(ray.m_tmin);
+		const __m512d tmax = _mm512_set1_pd(ray.m_tmax);
+
+		// The tail is handled by masking off the lanes past end.
+		for (std::size_t i = begin; i < end; i += 8u) {
+			const __mmask8 lanes = (8u <= end - i) ? __mmask8(0xFF) : __mmask8((1u << (end - i)) - 1u);
+
+			const __m512d opx = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, &spheres.m_px[i]), ox);
+			const __m512d opy = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, &spheres.m_py[i]), oy);
+			const __m512d opz = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, &spheres.m_pz[i]), oz);
+			const __m512d dop = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, opx), _mm512_mul_pd(dy, opy)), _mm512_mul_pd(dz, opz));
+			const __m512d opop = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(opx, opx), _mm512_mul_pd(opy, opy)), _mm512_mul_pd(opz, opz));
+			const __m512d D = _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(dop, dop), opop), _mm512_maskz_loadu_pd(lanes, &spheres.m_r2[i]));
+			const __m512d sqrtD = _mm512_sqrt_pd(D);
+
+			const __m512d t0 = _mm512_sub_pd(dop, sqrtD);
+			const __m512d t1 = _mm512_add_pd(dop, sqrtD);
+			const __mmask8 valid0 = _mm512_cmp_pd_mask(tmin, t0, _CMP_LT_OQ) & _mm512_cmp_pd_mask(t0, tmax, _CMP_LT_OQ);
+			const __mmask8 valid1 = _mm512_cmp_pd_mask(tmin, t1, _CMP_LT_OQ) & _mm512_cmp_pd_mask(t1, tmax, _CMP_LT_OQ);
+			if (0u != (lanes & (valid0 | valid1))) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	SMALLPT_END_AVX512_KERNELS
+
+	#endif
+
+	[[nodiscard]]
+	inline OccludedKernel SelectOccludedKernel(SimdLevel level) noexcept {
+		switch (level) {
+		#ifdef SMALLPT_X86
+		case SimdLevel::AVX512:
+			return OccludedSpheresAVX512;
+		case SimdLevel::AVX2:
+			return OccludedSpheresAVX2;
+		case SimdLevel::SSE2:
+			return OccludedSpheresSSE2;
+		#endif
+		default:
+			return OccludedSpheresScalar;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	// Packet Intersection Kernels
+	//-------------------------------------------------------------------------
+
+	// Intersects every active ray of the packet with the spheres [begin, end),
+	// updating m_hit and m_tmax of each lane and setting its bit in 
+	// m_hit_lanes if it hits (the contract of IntersectKernel per lane).
+	using IntersectPacketKernel = void (*)(const SphereSoA& spheres,
+										   std::size_t begin,
+										   std::size_t end,
+										   RayPacket& packet) noexcept;
+
+	inline void IntersectPacketScalar(const SphereSoA& spheres,
+									  std::size_t begin,
+									  std::size_t end,
+									  RayPacket& packet) noexcept {
+		for (std::size_t lane = 0u; lane < packet.size(); ++lane) {
+			const Ray ray = packet.GetRay(lane);
+			std::size_t hit;
+			if (IntersectSpheresScalar(spheres, begin, end, ray, hit)) {
+				packet.m_tmax[lane] = ray.m_tmax;
+				packet.m_hit[lane]  = static_cast< std::int32_t >(hit);
+				packet.m_hit_lanes |= 1u << lane;
+			}
+		}
+	}
+
+	#ifdef SMALLPT_X86
+
+	// Each kernel broadcasts one sphere at a time against a group of lanes
+	// (rays). Lanes without a ray are masked off, and groups without any
+	// are skipped. Sphere indices are carried in double lanes (exact below
+	// 2^31) so they can be blended like the distances.
+
+	SMALLPT_TARGET("sse2")
+	inline void IntersectPacketSSE2(const SphereSoA& spheres,
+									std::size_t begin,
+									std::size_t end,
+									RayPacket& packet) noexcept {
+		for (std::size_t j = 0u; j < g_packet_size; j += 2u) {
+			const std::uint32_t group = (packet.m_active_lanes >> j) & 0x3u;
+			if (0u == group) {
+				continue;
+			}
+
+			const __m128d active = _mm_castsi128_pd(_mm_set_epi64x((0u != (group & 0x2u)) ? -1 : 0, 
+																	(0u != (group & 0x1u)) ? -1 : 0));
+			const __m128d ox = _mm_loadu_pd(&packet.m_ox[j]);
+			const __m128d oy = _mm_loadu_pd(&packet.m_oy[j]);
+			const __m128d oz = _mm_loadu_pd(&packet.m_oz[j]);
+			const __m128d dx = _mm_loadu_pd(&packet.m_dx[j]);
+			const __m128d dy = _mm_loadu_pd(&packet.m_dy[j]);
+			const __m128d dz = _mm_loadu_pd(&packet.m_dz[j]);
+			const __m128d tmin = _mm_loadu_pd(&packet.m_tmin[j]);
+			__m128d tmax = _mm_loadu_pd(&packet.m_tmax[j]);
+			__m128d hits = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast< const __m128i* >(&packet.m_hit[j])));
+			int hit_lanes = 0;
+
+			for (std::size_t i = begin; i < end; ++i) {
+				const __m128d opx = _mm_sub_pd(_mm_set1_pd(spheres.m_px[i]), ox);
+				const __m128d opy = _mm_sub_pd(_mm_set1_pd(spheres.m_py[i]), oy);
+				const __m128d opz = _mm_sub_pd(_mm_set1_pd(spheres.m_pz[i]), oz);
+				const __m128d dop = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, opx), _mm_mul_pd(dy, opy)), _mm_mul_pd(dz, opz));
+				const __m128d opop = _mm_add_pd(_mm_add_pd(_mm_mul_pd(opx, opx), _mm_mul_pd(opy, opy)), _mm_mul_pd(opz, opz));
+				const __m128d D = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(dop, dop), opop), _mm_set1_pd(spheres.m_r2[i]));
+				const __m128d sqrtD = _mm_sqrt_pd(D);
+
+				const __m128d t0 = _mm_sub_pd(dop, sqrtD);
+				const __m128d t1 = _mm_add_pd(dop, sqrtD);
+				const __m128d valid0 = _mm_and_pd(active, _mm_and_pd(_mm_cmplt_pd(tmin, t0), _mm_cmplt_pd(t0, tmax)));
+				const __m128d valid1 = _mm_and_pd(active, _mm_and_pd(_mm_cmplt_pd(tmin, t1), _mm_cmplt_pd(t1, tmax)));
+				const __m128d closer = _mm_or_pd(valid0, valid1);
+				const int closer_lanes = _mm_movemask_pd(closer);
+				if (0 == closer_lanes) {
+					continue;
+				}
+
+				const __m128d t = _mm_or_pd(_mm_and_pd(valid0, t0), _mm_andnot_pd(valid0, t1));
+				tmax = _mm_or_pd(_mm_and_pd(closer, t), _mm_andnot_pd(closer, tmax));
+				hits = _mm_or_pd(_mm_and_pd(closer, _mm_set1_pd(static_cast< double >(i))), _mm_andnot_pd(closer, hits));
+				hit_lanes |= closer_lanes;
+			}
+
+			_mm_storeu_pd(&packet.m_tmax[j], tmax);
+			_mm_storel_epi64(reinterpret_cast< __m128i* >(&packet.m_hit[j]), _mm_cvttpd_epi32(hits));
+			packet.m_hit_lanes |= static_cast< std::uint32_t >(hit_lanes) << j;
+		}
+	}
+
+	SMALLPT_TARGET("avx2")
+	inline void IntersectPacketAVX2(const SphereSoA& spheres,
+									std::size_t begin,
+									std::size_t end,
+									RayPacket& packet) noexcept {
+		const __m256i lane_bits = _mm256_setr_epi64x(0x1, 0x2, 0x4, 0x8);
+
+		for (std::size_t j = 0u; j < g_packet_size; j += 4u) {
+			const std::uint32_t group = (packet.m_active_lanes >> j) & 0xFu;
+			if (0u == group) {
+				continue;
+			}
+
+			const __m256d active = _mm256_castsi256_pd(_mm256_cmpeq_epi64(
+				_mm256_and_si256(_mm256_set1_epi64x(group), lane_bits), lane_bits));
+			const __m256d ox = _mm256_loadu_pd(&packet.m_ox[j]);
+			const __m256d oy = _mm256_loadu_pd(&packet.m_oy[j]);
+			const __m256d oz = _mm256_loadu_pd(&packet.m_oz[j]);
+			const __m256d dx = _mm256_loadu_pd(&packet.m_dx[j]);
+			const __m256d dy = _mm256_loadu_pd(&packet.m_dy[j]);
+			const __m256d dz = _mm256_loadu_pd(&packet.m_dz[j]);
+			const __m256d tmin = _mm256_loadu_pd(&packet.m_tmin[j]);
+			__m256d tmax = _mm256_loadu_pd(&packet.m_tmax[j]);
+			__m256d hits = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast< const __m128i* >(&packet.m_hit[j])));
+			int hit_lanes = 0;
+
+			for (std::size_t i = begin; i < end; ++i) {
+				const __m256d opx = _mm256_sub_pd(_mm256_set1_pd(spheres.m_px[i]), ox);
+				const __m256d opy = _mm256_sub_pd(_mm256_set1_pd(spheres.m_py[i]), oy);
+				const __m256d opz = _mm256_sub_pd(_mm256_set1_pd(spheres.m_pz[i]), oz);
+				const __m256d dop = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, opx), _mm256_mul_pd(dy, opy)), _mm256_mul_pd(dz, opz));
+				const __m256d opop = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(opx, opx), _mm256_mul_pd(opy, opy)), _mm256_mul_pd(opz, opz));
+				const __m256d D = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(dop, dop), opop), _mm256_set1_pd(spheres.m_r2[i]));
+				const __m256d sqrtD = _mm256_sqrt_pd(D);
+
+				const __m256d t0 = _mm256_sub_pd(dop, sqrtD);
+				const __m256d t1 = _mm256_add_pd(dop, sqrtD);
+				const __m256d valid0 = _mm256_and_pd(active, _mm256_and_pd(_mm256_cmp_pd(tmin, t0, _CMP_LT_OQ), _mm256_cmp_pd(t0, tmax, _CMP_LT_OQ)));
+				const __m256d valid1 = _mm256_and_pd(active, _mm256_and_pd(_mm256_cmp_pd(tmin, t1, _CMP_LT_OQ), _mm256_cmp_pd(t1, tmax, _CMP_LT_OQ)));
+				const __m256d closer = _mm256_or_pd(valid0, valid1);
+				const int closer_lanes = _mm256_movemask_pd(closer);
+				if (0 == closer_lanes) {
+					continue;
+				}
+
+				const __m256d t = _mm256_blendv_pd(t1, t0, valid0);
+				tmax = _mm256_blendv_pd(tmax, t, closer);
+				hits = _mm256_blendv_pd(hits, _mm256_set1_pd(static_cast< double >(i)), closer);
+				hit_lanes |= closer_lanes;
+			}
+
+			_mm256_storeu_pd(&packet.m_tmax[j], tmax);
+			_mm_storeu_si128(reinterpret_cast< __m128i* >(&packet.m_hit[j]), _mm256_cvttpd_epi32(hits));
+			packet.m_hit_lanes |= static_cast< std::uint32_t >(hit_lanes) << j;
+		}
+	}
+
+	SMALLPT_BEGIN_AVX512_KERNELS
+
+	SMALLPT_TARGET("avx512f")
+	inline void IntersectPacketAVX512(const SphereSoA& spheres,
+									  std::size_t begin,
+									  std::size_t end,
+									  RayPacket& packet) noexcept {
+		for (std::size_t j = 0u; j < g_packet_size; j += 8u) {
+			const __mmask8 active = static_cast< __mmask8 >(packet.m_active_lanes >> j);
+			if (0u == active) {
+				continue;
+			}
+
+			const __m512d ox = _mm512_loadu_pd(&packet.m_ox[j]);
+			const __m512d oy = _mm512_loadu_pd(&packet.m_oy[j]);
+			const __m512d oz = _mm512_loadu_pd(&packet.m_oz[j]);
+			const __m512d dx = _mm512_loadu_pd(&packet.m_dx[j]);
+			const __m512d dy = _mm512_loadu_pd(&packet.m_dy[j]);
+			const __m512d dz = _mm512_loadu_pd(&packet.m_dz[j]);
+			const __m512d tmin = _mm512_loadu_pd(&packet.m_tmin[j]);
+			__m512d tmax = _mm512_loadu_pd(&packet.m_tmax[j]);
+			__m512d hits = _mm512_cvtepi32_pd(_mm256_loadu_si256(reinterpret_cast< const __m256i* >(&packet.m_hit[j])));
+			__mmask8 hit_lanes = 0u;
+
+			for (std::size_t i = begin; i < end; ++i) {
+				const __m512d opx = _mm512_sub_pd(_mm512_set1_pd(spheres.m_px[i]), ox);
+				const __m512d opy = _mm512_sub_pd(_mm512_set1_pd(spheres.m_py[i]), oy);
+				const __m512d opz = _mm512_sub_pd(_mm512_set1_pd(spheres.m_pz[i]), oz);
+				const __m512d dop = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, opx), _mm512_mul_pd(dy, opy)), _mm512_mul_pd(dz, opz));
+				const __m512d opop = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(opx, opx), _mm512_mul_pd(opy, opy)), _mm512_mul_pd(opz, opz));
+				const __m512d D = _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(dop, dop), opop), _mm512_set1_pd(spheres.m_r2[i]));
+				const __m512d sqrtD = _mm512_sqrt_pd(D);
+
+				const __m512d t0 = _mm512_sub_pd(dop, sqrtD);
+				const __m512d t1 = _mm512_add_pd(dop, sqrtD);
+				const __mmask8 valid0 = _mm512_mask_cmp_pd_mask(_mm512_mask_cmp_pd_mask(active, tmin, t0, _CMP_LT_OQ), t0, tmax, _CMP_LT_OQ);
+				const __mmask8 valid1 = _mm512_mask_cmp_pd_mask(_mm512_mask_cmp_pd_mask(active, tmin, t1, _CMP_LT_OQ), t1, tmax, _CMP_LT_OQ);
+				const __mmask8 closer = valid0 | valid1;
+				if (0u == closer) {
+					continue;
+				}
+
+				const __m512d t = _mm512_mask_blend_pd(valid0, t1, t0);
+				tmax = _mm512_mask_blend_pd(closer, tmax, t);
+				hits = _mm512_mask_blend_pd(closer, hits, _mm512_set1_pd(static_cast< double >(i)));
+				hit_lanes |= closer;
+			}
+
+			_mm512_storeu_pd(&packet.m_tmax[j], tmax);
+			_mm256_storeu_si256(reinterpret_cast< __m256i* >(&packet.m_hit[j]), _mm512_cvttpd_epi32(hits));
+			packet.m_hit_lanes |= static_cast< std::uint32_t >(hit_lanes) << j;
+		}
+	}
+
+	SMALLPT_END_AVX512_KERNELS
+
+	#endif
+
+	[[nodiscard]]
+	inline IntersectKernel SelectIntersectKernel(SimdLevel level) noexcept {
+		switch (level) {
+		#ifdef SMALLPT_X86
+		case SimdLevel::AVX512:
+			return IntersectSpheresAVX512;
+		case SimdLevel::AVX2:
+			return IntersectSpheresAVX2;
+		case SimdLevel::SSE2:
+			return IntersectSpheresSSE2;
+		#endif
+		default:
+			return IntersectSpheresScalar;
+		}
+	}
+
+	[[nodiscard]]
+	inline IntersectPacketKernel SelectIntersectPacketKernel(SimdLevel level) noexcept {
+		switch (level) {
+		#ifdef SMALLPT_X86
+		case SimdLevel::AVX512:
+			return IntersectPacketAVX512;
+		case SimdLevel::AVX2:
+			return IntersectPacketAVX2;
+		case SimdLevel::SSE2:
+			return IntersectPacketSSE2;
+		#endif
+		default:
+			return IntersectPacketScalar;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Scene
+	//-------------------------------------------------------------------------
+
+	class Scene {
+
+	public:
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		// The spheres are stored in the leaf order of a BVH built over them, 
+		// which is traversed in its compressed wide form. The leaves are 
+		// intersected with the kernels of the widest instruction set of the
+		// CPU (or the given level). A few spheres are
+		// scanned linearly instead: the SIMD kernels test them faster than a
+		// traversal could cull them. The BVH is built with parallel_for (see
+		// SerialFor).
+		//
+		// The planes and boxes (a few large shapes, such as walls) are kept
+		// in a list per type and scanned before the spheres, so no query 
+		// dispatches per primitive and their hits narrow the BVH traversal.
+		// The primitives are indexed as the spheres, then the planes, then 
+		// the boxes.
+		template< typename ParallelForT = SerialFor >
+		explicit Scene(std::span< const Sphere > spheres,
+					   std::span< const Plane > planes = {},
+					   std::span< const Box > boxes = {},
+					   const ParallelForT& parallel_for = {},
+					   SimdLevel simd_level = DetectSimdLevel())
+			: m_spheres(),
+			m_planes(planes.begin(), planes.end()),
+			m_boxes(boxes.begin(), boxes.end()),
+			m_materials(),
+			m_lights(),
+			m_bvh(),
+			m_wide_bvh(),
+			m_simd_level(simd_level),
+			m_intersect(SelectIntersectKernel(simd_level)),
+			m_intersect_packet(SelectIntersectPacketKernel(simd_level)),
+			m_occluded(SelectOccludedKernel(simd_level)) {
+
+			CollectLights(spheres);
+
+			m_materials.reserve(planes.size() + boxes.size());
+			for (const Plane& plane : planes) {
+				m_materials.push_back({ plane.m_e, plane.m_f, plane.m_reflection_t });
+			}
+			for (const Box& box : boxes) {
+				m_materials.push_back({ box.m_e, box.m_f, box.m_reflection_t });
+			}
+
+			if (spheres.size() <= g_max_linear_spheres) {
+				for (const Sphere& sphere : spheres) {
+					m_spheres.push_back(sphere);
+				}
+				return;
+			}
+
+			m_bvh = BVH(ComputeBounds(spheres, parallel_for), parallel_for);
+			m_wide_bvh = WideBVH(m_bvh, simd_level);
+			Gather(spheres, parallel_for);
+		}
+		Scene(const Scene& scene) = default;
+		Scene(Scene&& scene) noexcept = default;
+		~Scene() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		Scene& operator=(const Scene& scene) = default;
+		Scene& operator=(Scene&& scene) noexcept = default;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		// Moves the spheres to the given ones: the spheres passed to the 
+		// constructor, in the same order, at new positions (or with new radii
+		// or materials). Refits the BVH (rebuilding the parts whose quality
+		// degraded beyond max_cost_ratio, see BVH::Refit) and its wide form
+		// (collapsing it again after rebuilds).
+		template< typename ParallelForT = SerialFor >
+		BVHUpdate Update(std::span< const Sphere > spheres,
+						 const ParallelForT& parallel_for = {},
+						 double max_cost_ratio = 1.3) {
+
+			CollectLights(spheres);
+			if (m_bvh.empty()) {
+				for (std::size_t i = 0u; i < spheres.size(); ++i) {
+					m_spheres.Set(i, spheres[i]);
+				}
+				return { BVHUpdate_t::Refit, 1.0, 0u };
+			}
+
+			const BVHUpdate update = m_bvh.Refit(ComputeBounds(spheres, parallel_for), parallel_for, max_cost_ratio);
+			if (BVHUpdate_t::Refit == update.m_type) {
+				m_wide_bvh.Refit(m_bvh, parallel_for);
+			}
+			else {
+				m_wide_bvh = WideBVH(m_bvh, m_simd_level);
+			}
+			Gather(spheres, parallel_for);
+			return update;
+		}
+
+		[[nodiscard]]
+		std::optional< std::size_t > Intersect(const Ray& ray) const noexcept {
+			std::size_t hit;
+			bool found = IntersectShapes(ray, hit);
+			if (m_wide_bvh.empty()) {
+				found |= m_intersect(m_spheres, 0u, m_spheres.size(), ray, hit);
+			}
+			else {
+				found |= m_wide_bvh.Intersect(ray, [this, &ray, &hit](std::size_t begin, 
+																	   std::size_t end) noexcept {
+					return m_intersect(m_spheres, begin, end, ray, hit);
+				});
+			}
+
+			if (found) {
+				return hit;
+			}
+			return {};
+		}
+
+		// Intersects all rays of the packet at once (see IntersectPacketKernel).
+		void Intersect(RayPacket& packet) const noexcept {
+			IntersectShapes(packet);
+			if (m_wide_bvh.empty()) {
+				m_intersect_packet(m_spheres, 0u, m_spheres.size(), packet);
+				return;
+			}
+
+			m_wide_bvh.Intersect(packet, [this](std::size_t begin, 
+												std::size_t end, 
+												RayPacket& leaf_packet) noexcept {
+				m_intersect_packet(m_spheres, begin, end, leaf_packet);
+			});
+		}
+
+		// Returns whether any primitive blocks the ray within 
+		// (ray.m_tmin, tmax), for shadow and visibility rays. Cheaper than
+		// Intersect: the query stops at the first hit found, whichever it is.
+		[[nodiscard]]
+		bool Occluded(const Ray& ray, double tmax) const noexcept {
+			const Ray segment(ray.m_o, ray.m_d, ray.m_tmin, tmax, ray.m_depth);
+			if (OccludedShapes(segment)) {
+				return true;
+			}
+			if (m_wide_bvh.empty()) {
+				return m_occluded(m_spheres, 0u, m_spheres.size(), segment);
+			}
+
+			return m_wide_bvh.Occluded(segment, [this, &segment](std::size_t begin, 
+																 std::size_t end) noexcept {
+				return m_occluded(m_spheres, begin, end, segment);
+			});
+		}
+
+		// The unit normal of primitive i at the point p of its surface: 
+		// pointing out of spheres and boxes, and along the normal of planes.
+		[[nodiscard]]
+		const Vector3 GetNormal(std::size_t i, const Vector3& p) const noexcept {
+			if (i < m_spheres.size()) {
+				return Normalize(p - Vector3(m_spheres.m_px[i], m_spheres.m_py[i], m_spheres.m_pz[i]));
+			}
+			
+			i -= m_spheres.size();
+			if (i < m_planes.size()) {
+				return m_planes[i].m_n;
+			}
+
+			return m_boxes[i - m_planes.size()].GetNormal(p);
+		}
+
+		// Sphere i (i < GetNumberOfSpheres()), e.g. the light a ray hit.
+		[[nodiscard]]
+		const Sphere GetSphere(std::size_t i) const noexcept {
+			const Material& material = m_spheres.m_materials[i];
+			return Sphere(std::sqrt(m_spheres.m_r2[i]), 
+						  Vector3(m_spheres.m_px[i], m_spheres.m_py[i], m_spheres.m_pz[i]), 
+						  material.m_e, material.m_f, material.m_reflection_t);
+		}
+
+		[[nodiscard]]
+		const Material& GetMaterial(std::size_t i) const noexcept {
+			if (i < m_spheres.size()) {
+				return m_spheres.m_materials[i];
+			}
+			return m_materials[i - m_spheres.size()];
+		}
+
+		// The emissive spheres, for sampling them (see SampleSphereLight). 
+		// The other emissive primitives are only found by hitting them.
+		[[nodiscard]]
+		std::span< const Sphere > GetLights() const noexcept {
+			return m_lights;
+		}
+
+		[[nodiscard]]
+		std::size_t GetNumberOfSpheres() const noexcept {
+			return m_spheres.size();
+		}
+
+		[[nodiscard]]
+		std::size_t GetNumberOfPlanes() const noexcept {
+			return m_planes.size();
+		}
+
+		[[nodiscard]]
+		std::size_t GetNumberOfBoxes() const noexcept {
+			return m_boxes.size();
+		}
+
+		[[nodiscard]]
+		const BVH& GetBVH() const noexcept {
+			return m_bvh;
+		}
+
+		[[nodiscard]]
+		const WideBVH& GetWideBVH() const noexcept {
+			return m_wide_bvh;
+		}
+
+		[[nodiscard]]
+		SimdLevel GetSimdLevel() const noexcept {
+			return m_simd_level;
+		}
+
+	private:
+
+		//---------------------------------------------------------------------
+		// Class Member Variables
+		//---------------------------------------------------------------------
+
+		static constexpr std::size_t g_max_linear_spheres = 16u;
+		// The number of spheres handled by a single task.
+		static constexpr std::size_t g_chunk_size = 4096u;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		// Intersects the ray with the planes and the boxes (see IntersectKernel).
+		[[nodiscard]]
+		bool IntersectShapes(const Ray& ray, std::size_t& hit) const noexcept {
+			bool found = false;
+			
+			const std::size_t first_plane = m_spheres.size();
+			for (std::size_t i = 0u; i < m_planes.size(); ++i) {
+				if (m_planes[i].Intersect(ray)) {
+					hit = first_plane + i;
+					found = true;
+				}
+			}
+
+			const std::size_t first_box = first_plane + m_planes.size();
+			for (std::size_t i = 0u; i < m_boxes.size(); ++i) {
+				if (m_boxes[i].Intersect(ray)) {
+					hit = first_box + i;
+					found = true;
+				}
+			}
+
+			return found;
+		}
+
+		// Intersects every active ray of the packet with the planes and the
+		// boxes, one ray at a time.
+		void IntersectShapes(RayPacket& packet) const noexcept {
+			if (m_planes.empty() && m_boxes.empty()) {
+				return;
+			}
+
+			for (std::uint32_t lanes = packet.m_active_lanes; 0u != lanes; lanes &= lanes - 1u) {
+				const std::size_t lane = static_cast< std::size_t >(std::countr_zero(lanes));
+				const Ray ray = packet.GetRay(lane);
+				std::size_t hit;
+				if (IntersectShapes(ray, hit)) {
+					packet.m_tmax[lane] = ray.m_tmax;
+					packet.m_hit[lane]  = static_cast< std::int32_t >(hit);
+					packet.m_hit_lanes |= 1u << lane;
+				}
+			}
+		}
+
+		[[nodiscard]]
+		bool OccludedShapes(const Ray& ray) const noexcept {
+			for (const Plane& plane : m_planes) {
+				if (plane.Intersect(ray)) {
+					return true;
+				}
+			}
+			for (const Box& box : m_boxes) {
+				if (box.Intersect(ray)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void CollectLights(std::span< const Sphere > spheres) {
+			m_lights.clear();
+			for (const Sphere& sphere : spheres) {
+				if (Vector3() != sphere.m_e) {
+					m_lights.push_back(sphere);
+				}
+			}
+		}
+
+		// Calls body(i) for every i in [0, n), in chunks run with parallel_for.
+		template< typename ParallelForT, typename BodyT >
+		static void ForEachChunked(std::size_t n, 
+								   const ParallelForT& parallel_for, 
+								   const BodyT& body) {
+			parallel_for((n + g_chunk_size - 1u) / g_chunk_size, [n, &body](std::size_t chunk) noexcept {
+				const std::size_t end = std::min(n, (chunk + 1u) * g_chunk_size);
+				for (std::size_t i = chunk * g_chunk_size; i < end; ++i) {
+					body(i);
+				}
+			});
+		}
+
+		template< typename ParallelForT >
+		[[nodiscard]]
+		static std::vector< AABB > ComputeBounds(std::span< const Sphere > spheres,
+												 const ParallelForT& parallel_for) {
+			std::vector< AABB > bounds(spheres.size());
+			ForEachChunked(spheres.size(), parallel_for, [&spheres, &bounds](std::size_t i) noexcept {
+				bounds[i] = AABB(spheres[i].m_p - spheres[i].m_r, spheres[i].m_p + spheres[i].m_r);
+			});
+			return bounds;
+		}
+
+		// Stores the spheres in the leaf order of the BVH.
+		template< typename ParallelForT >
+		void Gather(std::span< const Sphere > spheres, const ParallelForT& parallel_for) {
+			const std::vector< std::uint32_t >& order = m_bvh.GetPrimitiveOrder();
+			m_spheres.resize(spheres.size());
+			ForEachChunked(spheres.size(), parallel_for, [this, &spheres, &order](std::size_t i) noexcept {
+				m_spheres.Set(i, spheres[order[i]]);
+			});
+		}
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		SphereSoA m_spheres;
+		std::vector< Plane > m_planes;
+		std::vector< Box > m_boxes;
+		std::vector< Material > m_materials; // of the planes, then the boxes
+		std::vector< Sphere > m_lights;
+		BVH m_bvh;
+		WideBVH m_wide_bvh;
+		SimdLevel m_simd_level;
+		IntersectKernel m_intersect;
+		IntersectPacketKernel m_intersect_packet;
+		OccludedKernel m_occluded;
+	};
+}
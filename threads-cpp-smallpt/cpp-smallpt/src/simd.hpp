@@ -0,0 +1,126 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define SMALLPT_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+#pragma region
+
+// MSVC accepts the intrinsics of any instruction set in any function, while
+// GCC and Clang only accept them in functions compiled for that set.
+#if defined(SMALLPT_X86) && !defined(_MSC_VER)
+	#define SMALLPT_TARGET(isa) __attribute__((target(isa)))
+#else
+	#define SMALLPT_TARGET(isa)
+#endif
+
+// GCC 12 implements _mm512_undefined_pd() and friends by initializing a
+// variable with itself, and passes them to the unmasked forms of many 
+// AVX-512 intrinsics (e.g., _mm512_sqrt_pd), so -Wuninitialized flags every
+// function these are inlined into. Enclose the AVX-512 kernels in these.
+#if defined(SMALLPT_X86) && defined(__GNUC__) && !defined(__clang__)
+	#define SMALLPT_BEGIN_AVX512_KERNELS                            \
+		_Pragma("GCC diagnostic push")                              \
+		_Pragma("GCC diagnostic ignored \"-Wuninitialized\"")       \
+		_Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+	#define SMALLPT_END_AVX512_KERNELS _Pragma("GCC diagnostic pop")
+#else
+	#define SMALLPT_BEGIN_AVX512_KERNELS
+	#define SMALLPT_END_AVX512_KERNELS
+#endif
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: SimdLevel
+	//-------------------------------------------------------------------------
+
+	enum struct SimdLevel : std::uint8_t {
+		Scalar = 0u,
+		SSE2,   // 2 doubles per instruction
+		AVX2,   // 4 doubles per instruction
+		AVX512  // 8 doubles per instruction
+	};
+
+	[[nodiscard]]
+	constexpr const char* ToString(SimdLevel level) noexcept {
+		switch (level) {
+		case SimdLevel::SSE2:
+			return "SSE2";
+		case SimdLevel::AVX2:
+			return "AVX2";
+		case SimdLevel::AVX512:
+			return "AVX-512";
+		default:
+			return "scalar";
+		}
+	}
+
+	// The widest instruction set supported by both the CPU and the OS (which
+	// has to save the wider registers on context switches).
+	[[nodiscard]]
+	inline SimdLevel DetectSimdLevel() noexcept {
+		#if !defined(SMALLPT_X86)
+		return SimdLevel::Scalar;
+		#elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		const int max_leaf = info[0];
+
+		__cpuid(info, 1);
+		const bool has_sse2   = (0 != (info[3] & (1 << 26)));
+		const bool has_xsave  = (0 != (info[2] & (1 << 27)));
+		const bool has_avx    = (0 != (info[2] & (1 << 28)));
+
+		bool has_avx2    = false;
+		bool has_avx512f = false;
+		if (7 <= max_leaf) {
+			__cpuidex(info, 7, 0);
+			has_avx2    = (0 != (info[1] & (1 << 5)));
+			has_avx512f = (0 != (info[1] & (1 << 16)));
+		}
+
+		const unsigned long long xcr0 = has_xsave ? _xgetbv(0) : 0ull;
+		const bool os_avx    = (0x06ull == (xcr0 & 0x06ull)); // XMM, YMM
+		const bool os_avx512 = (0xE6ull == (xcr0 & 0xE6ull)); // XMM, YMM, opmask, ZMM
+
+		if (has_avx512f && os_avx512) {
+			return SimdLevel::AVX512;
+		}
+		if (has_avx && has_avx2 && os_avx) {
+			return SimdLevel::AVX2;
+		}
+		return has_sse2 ? SimdLevel::SSE2 : SimdLevel::Scalar;
+		#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f")) {
+			return SimdLevel::AVX512;
+		}
+		if (__builtin_cpu_supports("avx2")) {
+			return SimdLevel::AVX2;
+		}
+		return __builtin_cpu_supports("sse2") ? SimdLevel::SSE2 : SimdLevel::Scalar;
+		#endif
+	}
+}
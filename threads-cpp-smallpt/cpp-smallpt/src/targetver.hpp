@@ -6,6 +6,8 @@
 #pragma region
 
 // Targetting the highest available Windows platform.
-#include <SDKDDKVer.h>
+#ifdef _WIN32
+	#include <SDKDDKVer.h>
+#endif
 
 #pragma endregion
\ No newline at end of file
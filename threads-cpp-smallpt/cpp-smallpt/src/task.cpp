@@ -1,102 +1,305 @@
+#include "deque.hpp"
 #include "lock.hpp"
 #include "task.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+
+#if !defined(SMALLPT_WIN32_THREADS) && defined(__linux__)
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
 namespace smallpt {
 
-	static HANDLE* s_threads;
-	static Mutex s_s_task_queue_mutex;
-	static std::vector< Task* > s_task_queue;
-	static Semaphore* s_worker_semaphore;
-	static size_t s_nb_unfinished_tasks;
-	static ConditionVariable* s_tasks_running_condition;
+	using Clock = std::chrono::steady_clock;
 
-	static DWORD WINAPI task_entry([[maybe_unused]] LPVOID lpParameter) {
-		while (true) {
-			s_worker_semaphore->Wait();
+	[[nodiscard]]
+	static std::uint64_t ElapsedNanoseconds(Clock::time_point start) noexcept {
+		return static_cast< std::uint64_t >(
+			std::chrono::duration_cast< std::chrono::nanoseconds >(Clock::now() - start).count());
+	}
 
-			Task* task = nullptr;
-			{
-				MutexLock lock(s_s_task_queue_mutex);
-				if (s_task_queue.empty()) {
-					break;
-				}
-				task = s_task_queue.back();
-				s_task_queue.pop_back();
-			}
+	// Pins the calling thread to the given logical processor. Linux numbers
+	// the logical processors of one socket (NUMA node) consecutively on most
+	// systems, so consecutive workers share a socket.
+	static void PinCurrentThread(std::size_t processor) noexcept {
+		#if defined(SMALLPT_WIN32_THREADS)
+		const std::size_t nb_bits = 8u * sizeof(DWORD_PTR);
+		SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (processor % nb_bits));
+		#elif defined(__linux__)
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(static_cast< int >(processor % CPU_SETSIZE), &cpu_set);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+		#else
+		static_cast< void >(processor);
+		#endif
+	}
 
-			task->Run();
+	//-------------------------------------------------------------------------
+	// TaskGroup
+	//-------------------------------------------------------------------------
 
-			s_tasks_running_condition->Lock();
-			--s_nb_unfinished_tasks;
-			if (0u == s_nb_unfinished_tasks) {
-				s_tasks_running_condition->Signal();
+	TaskGroup::TaskGroup() noexcept
+		: m_nb_unfinished_tasks(0u),
+		m_pool(nullptr) {}
+
+	void TaskGroup::Wait() noexcept {
+		if (!m_pool) {
+			return;
+		}
+
+		while (true) {
+			// Read the epoch before the counter: a completion after this point
+			// changes the epoch and thus cannot be missed by the wait below.
+			const std::uint32_t epoch = m_pool->m_completion_epoch.load(std::memory_order_seq_cst);
+			if (0u == m_nb_unfinished_tasks.load(std::memory_order_seq_cst)) {
+				return;
 			}
-			s_tasks_running_condition->Unlock();
+			m_pool->m_completion_epoch.wait(epoch, std::memory_order_seq_cst);
 		}
-		return 0;
 	}
 
-	void TasksInit() {
-		static const std::size_t nb_s_threads = NumberOfSystemCores();
-		s_worker_semaphore        = new Semaphore();
-		s_tasks_running_condition = new ConditionVariable();
+	//-------------------------------------------------------------------------
+	// Worker
+	//-------------------------------------------------------------------------
+
+	// Each worker owns a deque it pushes to and pops from at the bottom, while
+	// idle workers steal from the top of the deques of randomly chosen victims.
+	// EnqueueTasks cannot push onto a deque it does not own, so it hands a
+	// share of the tasks to each worker via a mailbox which the owner drains
+	// into its deque (and which thieves may raid if the owner is busy).
+	struct alignas(64) Worker {
+		ThreadPool* m_pool = nullptr;
+		std::size_t m_index = 0u;
+
+		WorkStealingDeque< Task* > m_queue;
+
+		Mutex m_mailbox_mutex;
+		std::vector< Task* > m_mailbox;
+		std::atomic< bool > m_has_mail = false;
+
+		std::minstd_rand m_victim_rng;
 
-		s_threads = new HANDLE[nb_s_threads];
-		for (std::size_t i = 0u; i < nb_s_threads; ++i) {
-			s_threads[i] = CreateThread(nullptr, 0, task_entry, reinterpret_cast< void * >(i), 0, nullptr);
+		std::atomic< std::uint64_t > m_nb_tasks    = 0u;
+		std::atomic< std::uint64_t > m_nb_steals   = 0u;
+		std::atomic< std::uint64_t > m_run_time    = 0u; // ns
+		std::atomic< std::uint64_t > m_steal_time  = 0u; // ns
+	};
+
+	[[nodiscard]]
+	static bool TakeMail(Worker& worker, Task*& task, bool keep_rest) {
+		if (!worker.m_has_mail.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		MutexLock lock(worker.m_mailbox_mutex);
+		if (worker.m_mailbox.empty()) {
+			return false;
+		}
+
+		task = worker.m_mailbox.back();
+		worker.m_mailbox.pop_back();
+		if (keep_rest) {
+			// Only the owner moves the remaining mail into its deque.
+			for (Task* const t : worker.m_mailbox) {
+				worker.m_queue.Push(t);
+			}
+			worker.m_mailbox.clear();
 		}
+		worker.m_has_mail.store(!worker.m_mailbox.empty(), std::memory_order_release);
+		return true;
 	}
 
-	void TasksCleanup() {
-		if (!s_worker_semaphore) {
-			return;
+	//-------------------------------------------------------------------------
+	// ThreadPool
+	//-------------------------------------------------------------------------
+
+	ThreadPool::ThreadPool(std::size_t nb_threads, ThreadAffinity affinity)
+		: m_nb_workers(std::max< std::size_t >(1u, nb_threads)),
+		m_affinity(affinity),
+		m_workers(new Worker[m_nb_workers]),
+		m_threads(),
+		m_work_epoch(0u),
+		m_completion_epoch(0u),
+		m_shutdown(false),
+		m_nb_queued_tasks(0u) {
+
+		for (std::size_t i = 0u; i < m_nb_workers; ++i) {
+			m_workers[i].m_pool  = this;
+			m_workers[i].m_index = i;
+			m_workers[i].m_victim_rng.seed(static_cast< std::uint32_t >(i + 1u));
+		}
+
+		m_threads.reserve(m_nb_workers);
+		for (std::size_t i = 0u; i < m_nb_workers; ++i) {
+			#ifdef SMALLPT_WIN32_THREADS
+			m_threads.push_back(CreateThread(nullptr, 0, WorkerEntry, &m_workers[i], 0, nullptr));
+			#else
+			m_threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+			#endif
 		}
+	}
 
-		static const std::size_t nb_s_threads = NumberOfSystemCores();
-		if (s_worker_semaphore) {
-			s_worker_semaphore->Signal(static_cast<std::uint32_t >(nb_s_threads));
+	ThreadPool::~ThreadPool() {
+		m_shutdown.store(true, std::memory_order_seq_cst);
+		m_work_epoch.fetch_add(1u, std::memory_order_seq_cst);
+		m_work_epoch.notify_all();
+
+		#ifdef SMALLPT_WIN32_THREADS
+		WaitForMultipleObjects(static_cast< DWORD >(m_threads.size()), m_threads.data(), TRUE, INFINITE);
+		for (const HANDLE thread : m_threads) {
+			CloseHandle(thread);
+		}
+		#else
+		for (auto& thread : m_threads) {
+			thread.join();
 		}
+		#endif
+	}
 
-		if (s_threads) {
-			WaitForMultipleObjects(static_cast< DWORD >(nb_s_threads), s_threads, TRUE, INFINITE);
+	[[nodiscard]]
+	ThreadPool& ThreadPool::Get(ThreadAffinity affinity) {
+		static ThreadPool s_pool(NumberOfSystemCores(), affinity);
+		return s_pool;
+	}
 
-			for (std::size_t i = 0u; i < nb_s_threads; ++i) {
-				CloseHandle(s_threads[i]);
+	#ifdef SMALLPT_WIN32_THREADS
+	DWORD WINAPI ThreadPool::WorkerEntry(LPVOID lpParameter) {
+		Worker* const worker = static_cast< Worker* >(lpParameter);
+		worker->m_pool->WorkerLoop(worker->m_index);
+		return 0;
+	}
+	#endif
+
+	[[nodiscard]]
+	bool ThreadPool::StealTask(std::size_t index, Task*& task) {
+		Worker& thief = m_workers[index];
+		std::uniform_int_distribution< std::size_t > distribution(0u, m_nb_workers - 1u);
+
+		for (std::size_t attempt = 0u; attempt < 2u * m_nb_workers; ++attempt) {
+			const std::size_t victim = distribution(thief.m_victim_rng);
+			if (victim == index) {
+				continue;
 			}
 
-			delete[] s_threads;
-			s_threads = nullptr;
+			if (m_workers[victim].m_queue.Steal(task)
+				|| TakeMail(m_workers[victim], task, false)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void ThreadPool::RunTask(Worker& worker, Task* task) noexcept {
+		m_nb_queued_tasks.fetch_sub(1u, std::memory_order_relaxed);
+
+		// The task may be destroyed once its group is finished.
+		TaskGroup* const group = task->m_group;
+
+		const auto start = Clock::now();
+		task->Run();
+		worker.m_run_time.fetch_add(ElapsedNanoseconds(start), std::memory_order_relaxed);
+		worker.m_nb_tasks.fetch_add(1u, std::memory_order_relaxed);
+
+		if (1u == group->m_nb_unfinished_tasks.fetch_sub(1u, std::memory_order_seq_cst)) {
+			m_completion_epoch.fetch_add(1u, std::memory_order_seq_cst);
+			m_completion_epoch.notify_all();
 		}
 	}
 
-	void EnqueueTasks(const std::vector< Task* >& tasks) {
-		if (!s_threads) {
-			TasksInit();
+	void ThreadPool::WorkerLoop(std::size_t index) {
+		Worker& worker = m_workers[index];
+
+		if (ThreadAffinity::Compact == m_affinity) {
+			PinCurrentThread(index);
 		}
 
-		{
-			MutexLock lock(s_s_task_queue_mutex);
-			for (std::size_t i = 0u; i < tasks.size(); ++i) {
-				s_task_queue.push_back(tasks[i]);
+		while (true) {
+			// Read the epoch before looking for work: an enqueue after this
+			// point changes the epoch and thus cannot be missed by the wait below.
+			const std::uint32_t epoch = m_work_epoch.load(std::memory_order_seq_cst);
+			if (m_shutdown.load(std::memory_order_seq_cst)) {
+				break;
 			}
-		}
 
-		s_tasks_running_condition->Lock();
-		s_nb_unfinished_tasks += tasks.size();
-		s_tasks_running_condition->Unlock();
+			// Keep looking for work as long as some tasks have not been started.
+			while (0u < m_nb_queued_tasks.load(std::memory_order_acquire)) {
+				Task* task = nullptr;
+				if (TakeMail(worker, task, true) || worker.m_queue.Pop(task)) {
+					RunTask(worker, task);
+					continue;
+				}
+
+				const auto start = Clock::now();
+				const bool stolen = StealTask(index, task);
+				worker.m_steal_time.fetch_add(ElapsedNanoseconds(start), std::memory_order_relaxed);
+
+				if (stolen) {
+					worker.m_nb_steals.fetch_add(1u, std::memory_order_relaxed);
+					RunTask(worker, task);
+				}
+				else {
+					std::this_thread::yield();
+				}
+			}
 
-		s_worker_semaphore->Signal(static_cast<std::uint32_t >(tasks.size()));
+			m_work_epoch.wait(epoch, std::memory_order_seq_cst);
+		}
 	}
 
-	void WaitForAllTasks() {
-		if (!s_tasks_running_condition) {
+	void ThreadPool::EnqueueTasks(const std::vector< Task* >& tasks, TaskGroup& group) {
+		if (tasks.empty()) {
 			return;
 		}
 
-		s_tasks_running_condition->Lock();
-		while (0u < s_nb_unfinished_tasks) {
-			s_tasks_running_condition->Wait();
+		for (Task* const task : tasks) {
+			task->m_group = &group;
+		}
+
+		group.m_pool = this;
+		group.m_nb_unfinished_tasks.fetch_add(tasks.size(), std::memory_order_seq_cst);
+		m_nb_queued_tasks.fetch_add(tasks.size(), std::memory_order_seq_cst);
+
+		// Hand each worker a contiguous share of the tasks.
+		const std::size_t nb_tasks = tasks.size();
+		for (std::size_t i = 0u; i < m_nb_workers; ++i) {
+			const std::size_t begin = (i * nb_tasks) / m_nb_workers;
+			const std::size_t end   = ((i + 1u) * nb_tasks) / m_nb_workers;
+			if (begin == end) {
+				continue;
+			}
+
+			Worker& worker = m_workers[i];
+			MutexLock lock(worker.m_mailbox_mutex);
+			worker.m_mailbox.insert(worker.m_mailbox.end(), tasks.begin() + begin, tasks.begin() + end);
+			worker.m_has_mail.store(true, std::memory_order_release);
+		}
+
+		m_work_epoch.fetch_add(1u, std::memory_order_seq_cst);
+		m_work_epoch.notify_all();
+	}
+
+	[[nodiscard]]
+	TaskStatistics ThreadPool::GetStatistics() const noexcept {
+		TaskStatistics statistics;
+		std::uint64_t run_time = 0u;
+		std::uint64_t steal_time = 0u;
+		for (std::size_t i = 0u; i < m_nb_workers; ++i) {
+			const Worker& worker = m_workers[i];
+			statistics.m_nb_tasks  += worker.m_nb_tasks.load(std::memory_order_relaxed);
+			statistics.m_nb_steals += worker.m_nb_steals.load(std::memory_order_relaxed);
+			run_time   += worker.m_run_time.load(std::memory_order_relaxed);
+			steal_time += worker.m_steal_time.load(std::memory_order_relaxed);
 		}
-		s_tasks_running_condition->Unlock();
+
+		statistics.m_run_time   = 1e-9 * run_time;
+		statistics.m_steal_time = 1e-9 * steal_time;
+		return statistics;
 	}
-};
\ No newline at end of file
+};
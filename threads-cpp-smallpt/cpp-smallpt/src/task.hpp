@@ -1,23 +1,41 @@
 #pragma once
 
+#include "lock.hpp"
+
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
-#include "windows.hpp"
+
+#include <algorithm>
+
+#ifndef SMALLPT_WIN32_THREADS
+	#include <thread>
+#endif
 
 namespace smallpt {
 
 	[[nodiscard]]
 	inline std::size_t NumberOfSystemCores() noexcept {
+		#ifdef SMALLPT_WIN32_THREADS
 		SYSTEM_INFO system_info;
 		GetSystemInfo(&system_info);
 		return static_cast< std::size_t >(system_info.dwNumberOfProcessors);
+		#else
+		// hardware_concurrency may return 0 if the value is not computable.
+		return std::max< std::size_t >(1u, std::thread::hardware_concurrency());
+		#endif
 	}
 
+	class TaskGroup;
+
 	class Task {
 
 	public:
 
+		friend class ThreadPool;
+
 		Task() = default;
 		Task(const Task& task) = default;
 		Task(Task&& task) = default;
@@ -27,11 +45,197 @@ namespace smallpt {
 		Task& operator=(Task&& task) = default;
 
 		virtual void Run() noexcept = 0;
+
+	private:
+
+		// The group this task was enqueued with.
+		TaskGroup* m_group = nullptr;
 	};
 
-	void TasksInit();
-	void TasksCleanup();
+	class ThreadPool;
+
+	// The completion handle of a job: a group of tasks enqueued on a thread
+	// pool that can be waited for independently of other jobs.
+	class TaskGroup final {
+
+	public:
+
+		friend class ThreadPool;
+
+		TaskGroup() noexcept;
+		TaskGroup(const TaskGroup& group) = delete;
+		TaskGroup(TaskGroup&& group) = delete;
+		~TaskGroup() = default;
+
+		TaskGroup& operator=(const TaskGroup& group) = delete;
+		TaskGroup& operator=(TaskGroup&& group) = delete;
+
+		// Blocks until all tasks enqueued with this group have finished.
+		void Wait() noexcept;
+
+	private:
+
+		// Completion is tracked with a single atomic decrement per task; only
+		// the last task of the group wakes the waiter (via the pool, since
+		// the group may be destroyed as soon as its counter reaches zero).
+		std::atomic< std::size_t > m_nb_unfinished_tasks;
+		ThreadPool* m_pool;
+	};
+
+	struct TaskStatistics {
+		std::uint64_t m_nb_tasks  = 0u; // number of tasks run
+		std::uint64_t m_nb_steals = 0u; // number of tasks stolen from other workers
+		double m_run_time   = 0.0;      // seconds spent running tasks (summed over workers)
+		double m_steal_time = 0.0;      // seconds spent looking for tasks to steal (summed over workers)
+	};
+
+	[[nodiscard]]
+	inline const TaskStatistics operator-(const TaskStatistics& lhs,
+										  const TaskStatistics& rhs) noexcept {
+		return {
+			lhs.m_nb_tasks   - rhs.m_nb_tasks,
+			lhs.m_nb_steals  - rhs.m_nb_steals,
+			lhs.m_run_time   - rhs.m_run_time,
+			lhs.m_steal_time - rhs.m_steal_time
+		};
+	}
+
+	enum struct ThreadAffinity : std::uint8_t {
+		None = 0u, // leave thread placement to the OS
+		Compact    // pin worker i to logical processor i (filling a socket before the next)
+	};
+
+	struct Worker;
+
+	// A pool of worker threads that live as long as the pool and run the
+	// tasks of any number of jobs.
+	class ThreadPool final {
+
+	public:
+
+		friend class TaskGroup;
 
-	void EnqueueTasks(const std::vector< Task* >& tasks);
-	void WaitForAllTasks();
-}
\ No newline at end of file
+		explicit ThreadPool(std::size_t nb_threads = NumberOfSystemCores(), 
+							ThreadAffinity affinity = ThreadAffinity::None);
+		ThreadPool(const ThreadPool& pool) = delete;
+		ThreadPool(ThreadPool&& pool) = delete;
+		~ThreadPool();
+
+		ThreadPool& operator=(const ThreadPool& pool) = delete;
+		ThreadPool& operator=(ThreadPool&& pool) = delete;
+
+		// The process-wide thread pool, created on first use (with the
+		// affinity passed to that first call).
+		[[nodiscard]]
+		static ThreadPool& Get(ThreadAffinity affinity = ThreadAffinity::None);
+
+		[[nodiscard]]
+		std::size_t GetNumberOfThreads() const noexcept {
+			return m_nb_workers;
+		}
+
+		// Enqueues the given tasks as part of the given group. The tasks
+		// must stay alive until the group has been waited for.
+		void EnqueueTasks(const std::vector< Task* >& tasks, TaskGroup& group);
+
+		// Calls body(i) for every i in [begin, end) and waits for all calls to
+		// finish. The range is split into chunks of chunk_size consecutive 
+		// indices, distributed over the workers like the tasks of a job. The
+		// only allocations are two per call (not per index or chunk); the 
+		// body is shared by reference between all chunks.
+		template< typename BodyT >
+		void ParallelFor(std::size_t begin, 
+						 std::size_t end, 
+						 std::size_t chunk_size, 
+						 const BodyT& body);
+
+		// The statistics accumulated over the lifetime of this pool.
+		[[nodiscard]]
+		TaskStatistics GetStatistics() const noexcept;
+
+	private:
+
+		#ifdef SMALLPT_WIN32_THREADS
+		static DWORD WINAPI WorkerEntry(LPVOID lpParameter);
+		#endif
+
+		void WorkerLoop(std::size_t index);
+		void RunTask(Worker& worker, Task* task) noexcept;
+		[[nodiscard]]
+		bool StealTask(std::size_t index, Task*& task);
+
+		std::size_t m_nb_workers;
+		ThreadAffinity m_affinity;
+		std::unique_ptr< Worker[] > m_workers;
+
+		#ifdef SMALLPT_WIN32_THREADS
+		std::vector< HANDLE > m_threads;
+		#else
+		std::vector< std::thread > m_threads;
+		#endif
+
+		// Idle workers and waiting threads block on these counters with C++20
+		// atomic waits (futex/WaitOnAddress), so finishing a task costs a
+		// single atomic decrement and only sleeping threads enter the kernel.
+		std::atomic< std::uint32_t > m_work_epoch;
+		std::atomic< std::uint32_t > m_completion_epoch;
+
+		std::atomic< bool > m_shutdown;
+		std::atomic< std::size_t > m_nb_queued_tasks;
+	};
+
+	template< typename BodyT >
+	class RangeTask final : public Task {
+
+	public:
+
+		explicit RangeTask(std::size_t begin, std::size_t end, const BodyT& body) noexcept
+			: m_begin(begin), 
+			m_end(end), 
+			m_body(&body) {}
+		RangeTask(const RangeTask& task) noexcept = default;
+		RangeTask(RangeTask&& task) noexcept = default;
+		virtual ~RangeTask() = default;
+
+		RangeTask& operator=(const RangeTask& task) = delete;
+		RangeTask& operator=(RangeTask&& task) = delete;
+
+		virtual void Run() noexcept final override {
+			for (std::size_t i = m_begin; i < m_end; ++i) {
+				(*m_body)(i);
+			}
+		}
+
+	private:
+
+		std::size_t m_begin;
+		std::size_t m_end;
+		const BodyT* m_body;
+	};
+
+	template< typename BodyT >
+	void ThreadPool::ParallelFor(std::size_t begin, 
+								 std::size_t end, 
+								 std::size_t chunk_size, 
+								 const BodyT& body) {
+		if (end <= begin) {
+			return;
+		}
+
+		chunk_size = std::max< std::size_t >(1u, chunk_size);
+		const std::size_t nb_chunks = (end - begin + chunk_size - 1u) / chunk_size;
+
+		std::vector< RangeTask< BodyT > > tasks;
+		tasks.reserve(nb_chunks);
+		std::vector< Task* > task_ptrs;
+		task_ptrs.reserve(nb_chunks);
+		for (std::size_t i = begin; i < end; i += chunk_size) {
+			tasks.emplace_back(i, std::min(end, i + chunk_size), body);
+			task_ptrs.push_back(&tasks.back());
+		}
+
+		TaskGroup group;
+		EnqueueTasks(task_ptrs, group);
+		group.Wait();
+	}
+}
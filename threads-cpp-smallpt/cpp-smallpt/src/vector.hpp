@@ -15,6 +15,7 @@
 #pragma region
 
 #include <iostream>
+#include <type_traits>
 
 #pragma endregion
 
@@ -24,10 +25,12 @@
 namespace smallpt {
 
 	//-------------------------------------------------------------------------
-	// Vector3
+	// BasicVector3
 	//-------------------------------------------------------------------------
 
-	struct Vector3 {
+	// A 3D vector of the scalar type T (float or double).
+	template< typename T >
+	struct BasicVector3 {
 
 	public:
 
@@ -35,20 +38,25 @@ namespace smallpt {
 		// Constructors and Destructors
 		//---------------------------------------------------------------------
 
-		constexpr explicit Vector3(double xyz = 0.0) noexcept
-			: Vector3(xyz, xyz, xyz) {}
-		constexpr Vector3(double x, double y, double z) noexcept
+		constexpr explicit BasicVector3(T xyz = T(0)) noexcept
+			: BasicVector3(xyz, xyz, xyz) {}
+		constexpr BasicVector3(T x, T y, T z) noexcept
 			: m_x(x), m_y(y), m_z(z) {}
-		constexpr Vector3(const Vector3& v) noexcept = default;
-		constexpr Vector3(Vector3&& v) noexcept = default;
-		~Vector3() = default;
+		template< typename U >
+		constexpr explicit BasicVector3(const BasicVector3< U >& v) noexcept
+			: m_x(static_cast< T >(v.m_x)), 
+			m_y(static_cast< T >(v.m_y)), 
+			m_z(static_cast< T >(v.m_z)) {}
+		constexpr BasicVector3(const BasicVector3& v) noexcept = default;
+		constexpr BasicVector3(BasicVector3&& v) noexcept = default;
+		~BasicVector3() = default;
 
 		//---------------------------------------------------------------------
 		// Assignment Operators
 		//---------------------------------------------------------------------
 
-		Vector3& operator=(const Vector3& v) = default;
-		Vector3& operator=(Vector3&& v) = default;
+		BasicVector3& operator=(const BasicVector3& v) = default;
+		BasicVector3& operator=(BasicVector3&& v) = default;
 
 		//---------------------------------------------------------------------
 		// Member Methods
@@ -60,102 +68,102 @@ namespace smallpt {
 		}
 
 		[[nodiscard]]
-		constexpr const Vector3 operator-() const noexcept {
+		constexpr const BasicVector3 operator-() const noexcept {
 			return { -m_x, -m_y, -m_z };
 		}
 		
 		[[nodiscard]]
-		constexpr const Vector3 operator+(const Vector3& v) const noexcept {
+		constexpr const BasicVector3 operator+(const BasicVector3& v) const noexcept {
 			return { m_x + v.m_x, m_y + v.m_y, m_z + v.m_z };
 		}
 		
 		[[nodiscard]]
-		constexpr const Vector3 operator-(const Vector3& v) const noexcept {
+		constexpr const BasicVector3 operator-(const BasicVector3& v) const noexcept {
 			return { m_x - v.m_x, m_y - v.m_y, m_z - v.m_z };
 		}
 		
 		[[nodiscard]]
-		constexpr const Vector3 operator*(const Vector3& v) const noexcept {
+		constexpr const BasicVector3 operator*(const BasicVector3& v) const noexcept {
 			return { m_x * v.m_x, m_y * v.m_y, m_z * v.m_z };
 		}
 		
 		[[nodiscard]]
-		constexpr const Vector3 operator/(const Vector3& v) const noexcept {
+		constexpr const BasicVector3 operator/(const BasicVector3& v) const noexcept {
 			return { m_x / v.m_x, m_y / v.m_y, m_z / v.m_z };
 		}
 		
 		[[nodiscard]]
-		constexpr const Vector3 operator+(double a) const noexcept {
+		constexpr const BasicVector3 operator+(T a) const noexcept {
 			return { m_x + a, m_y + a, m_z + a };
 		}
 		
 		[[nodiscard]]
-		constexpr const Vector3 operator-(double a) const noexcept {
+		constexpr const BasicVector3 operator-(T a) const noexcept {
 			return { m_x - a, m_y - a, m_z - a };
 		}
 		
 		[[nodiscard]]
-		constexpr const Vector3 operator*(double a) const noexcept {
+		constexpr const BasicVector3 operator*(T a) const noexcept {
 			return { m_x * a, m_y * a, m_z * a };
 		}
 		
 		[[nodiscard]]
-		constexpr const Vector3 operator/(double a) const noexcept {
-			const double inv_a = 1.0 / a;
+		constexpr const BasicVector3 operator/(T a) const noexcept {
+			const T inv_a = T(1) / a;
 			return { m_x * inv_a, m_y * inv_a, m_z * inv_a };
 		}
 		
-		Vector3& operator+=(const Vector3& v) noexcept {
+		BasicVector3& operator+=(const BasicVector3& v) noexcept {
 			m_x += v.m_x;
 			m_y += v.m_y;
 			m_z += v.m_z;
 			return *this;
 		}
 		
-		Vector3& operator-=(const Vector3& v) noexcept {
+		BasicVector3& operator-=(const BasicVector3& v) noexcept {
 			m_x -= v.m_x;
 			m_y -= v.m_y;
 			m_z -= v.m_z;
 			return *this;
 		}
 		
-		Vector3& operator*=(const Vector3& v) noexcept {
+		BasicVector3& operator*=(const BasicVector3& v) noexcept {
 			m_x *= v.m_x;
 			m_y *= v.m_y;
 			m_z *= v.m_z;
 			return *this;
 		}
 		
-		Vector3& operator/=(const Vector3& v) noexcept {
+		BasicVector3& operator/=(const BasicVector3& v) noexcept {
 			m_x /= v.m_x;
 			m_y /= v.m_y;
 			m_z /= v.m_z;
 			return *this;
 		}
 		
-		Vector3& operator+=(double a) noexcept {
+		BasicVector3& operator+=(T a) noexcept {
 			m_x += a;
 			m_y += a;
 			m_z += a;
 			return *this;
 		}
 		
-		Vector3& operator-=(double a) noexcept {
+		BasicVector3& operator-=(T a) noexcept {
 			m_x -= a;
 			m_y -= a;
 			m_z -= a;
 			return *this;
 		}
 		
-		Vector3& operator*=(double a) noexcept {
+		BasicVector3& operator*=(T a) noexcept {
 			m_x *= a;
 			m_y *= a;
 			m_z *= a;
 			return *this;
 		}
 		
-		Vector3& operator/=(double a) noexcept {
-			const double inv_a = 1.0 / a;
+		BasicVector3& operator/=(T a) noexcept {
+			const T inv_a = T(1) / a;
 			m_x *= inv_a;
 			m_y *= inv_a;
 			m_z *= inv_a;
@@ -163,12 +171,12 @@ namespace smallpt {
 		}
 
 		[[nodiscard]]
-		constexpr double Dot(const Vector3& v) const noexcept {
+		constexpr T Dot(const BasicVector3& v) const noexcept {
 			return m_x * v.m_x + m_y * v.m_y + m_z * v.m_z;
 		}
 		
 		[[nodiscard]]
-		constexpr const Vector3 Cross(const Vector3& v) const noexcept {
+		constexpr const BasicVector3 Cross(const BasicVector3& v) const noexcept {
 			return {
 				m_y * v.m_z - m_z * v.m_y,
 				m_z * v.m_x - m_x * v.m_z,
@@ -177,22 +185,22 @@ namespace smallpt {
 		}
 
 		[[nodiscard]]
-		constexpr bool operator==(const Vector3& rhs) const {
+		constexpr bool operator==(const BasicVector3& rhs) const {
 			return m_x == rhs.m_x && m_y == rhs.m_y && m_z == rhs.m_z;
 		}
 		
 		[[nodiscard]]
-		constexpr bool operator!=(const Vector3& rhs) const {
+		constexpr bool operator!=(const BasicVector3& rhs) const {
 			return !(*this == rhs);
 		}
 		
 		[[nodiscard]]
-		double& operator[](std::size_t i) noexcept {
+		T& operator[](std::size_t i) noexcept {
 			return (&m_x)[i];
 		}
 		
 		[[nodiscard]]
-		constexpr double operator[](std::size_t i) const noexcept {
+		constexpr T operator[](std::size_t i) const noexcept {
 			return (&m_x)[i];
 		}
 		
@@ -207,26 +215,26 @@ namespace smallpt {
 		}
 		
 		[[nodiscard]]
-		constexpr double Min() const noexcept {
+		constexpr T Min() const noexcept {
 			return std::min(m_x, std::min(m_y, m_z));
 		}
 		[[nodiscard]]
-		constexpr double Max() const noexcept {
+		constexpr T Max() const noexcept {
 			return std::max(m_x, std::max(m_y, m_z));
 		}
 
 		[[nodiscard]]
-		constexpr double Norm2_squared() const noexcept {
+		constexpr T Norm2_squared() const noexcept {
 			return m_x * m_x + m_y * m_y + m_z * m_z;
 		}
 		
 		[[nodiscard]]
-		double Norm2() const noexcept {
+		T Norm2() const noexcept {
 			return std::sqrt(Norm2_squared());
 		}
 		
 		void Normalize() noexcept {
-			const double a = 1.0 / Norm2();
+			const T a = T(1) / Norm2();
 			m_x *= a;
 			m_y *= a;
 			m_z *= a;
@@ -236,40 +244,49 @@ namespace smallpt {
 		// Member Variables
 		//---------------------------------------------------------------------
 
-		double m_x, m_y, m_z;
+		T m_x, m_y, m_z;
 	};
+
+	using Vector3  = BasicVector3< double >;
+	using Vector3f = BasicVector3< float >;
 	
 	//-------------------------------------------------------------------------
 	// Vector3 Utilities
 	//-------------------------------------------------------------------------
 
-	std::ostream& operator<<(std::ostream& os, const Vector3& v) {
+	template< typename T >
+	std::ostream& operator<<(std::ostream& os, const BasicVector3< T >& v) {
 		os << '[' << v.m_x << ' ' << v.m_y << ' ' << v.m_z << ']';
 		return os;
 	}
 
+	template< typename T >
 	[[nodiscard]]
-	constexpr const Vector3 operator+(double a, const Vector3& v) noexcept {
+	constexpr const BasicVector3< T > operator+(std::type_identity_t< T > a, const BasicVector3< T >& v) noexcept {
 		return { a + v.m_x, a + v.m_y, a + v.m_z };
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	constexpr const Vector3 operator-(double a, const Vector3& v) noexcept {
+	constexpr const BasicVector3< T > operator-(std::type_identity_t< T > a, const BasicVector3< T >& v) noexcept {
 		return { a - v.m_x, a - v.m_y, a - v.m_z };
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	constexpr const Vector3 operator*(double a, const Vector3& v) noexcept {
+	constexpr const BasicVector3< T > operator*(std::type_identity_t< T > a, const BasicVector3< T >& v) noexcept {
 		return { a * v.m_x, a * v.m_y, a * v.m_z };
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	constexpr const Vector3 operator/(double a, const Vector3& v) noexcept {
+	constexpr const BasicVector3< T > operator/(std::type_identity_t< T > a, const BasicVector3< T >& v) noexcept {
 		return { a / v.m_x, a / v.m_y, a / v.m_z };
 	}
 
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 Sqrt(const Vector3& v) noexcept {
+	inline const BasicVector3< T > Sqrt(const BasicVector3< T >& v) noexcept {
 		return { 
 			std::sqrt(v.m_x), 
 			std::sqrt(v.m_y), 
@@ -277,8 +294,9 @@ namespace smallpt {
 		};
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 Pow(const Vector3& v, double a) noexcept {
+	inline const BasicVector3< T > Pow(const BasicVector3< T >& v, std::type_identity_t< T > a) noexcept {
 		return { 
 			std::pow(v.m_x, a), 
 			std::pow(v.m_y, a), 
@@ -286,8 +304,9 @@ namespace smallpt {
 		};
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 Abs(const Vector3& v) noexcept {
+	inline const BasicVector3< T > Abs(const BasicVector3< T >& v) noexcept {
 		return { 
 			std::abs(v.m_x), 
 			std::abs(v.m_y), 
@@ -295,8 +314,9 @@ namespace smallpt {
 		};
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	constexpr const Vector3 Min(const Vector3& v1, const Vector3& v2) noexcept {
+	constexpr const BasicVector3< T > Min(const BasicVector3< T >& v1, const BasicVector3< T >& v2) noexcept {
 		return {
 			std::min(v1.m_x, v2.m_x),
 			std::min(v1.m_y, v2.m_y),
@@ -304,8 +324,9 @@ namespace smallpt {
 		};
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	constexpr const Vector3 Max(const Vector3& v1, const Vector3& v2) noexcept {
+	constexpr const BasicVector3< T > Max(const BasicVector3< T >& v1, const BasicVector3< T >& v2) noexcept {
 		return {
 			std::max(v1.m_x, v2.m_x),
 			std::max(v1.m_y, v2.m_y),
@@ -313,8 +334,9 @@ namespace smallpt {
 		};
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 Round(const Vector3& v) noexcept {
+	inline const BasicVector3< T > Round(const BasicVector3< T >& v) noexcept {
 		return {
 			std::round(v.m_x),
 			std::round(v.m_y),
@@ -322,8 +344,9 @@ namespace smallpt {
 		};
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 Floor(const Vector3& v) noexcept {
+	inline const BasicVector3< T > Floor(const BasicVector3< T >& v) noexcept {
 		return {
 			std::floor(v.m_x),
 			std::floor(v.m_y),
@@ -331,8 +354,9 @@ namespace smallpt {
 		};
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 Ceil(const Vector3& v) noexcept {
+	inline const BasicVector3< T > Ceil(const BasicVector3< T >& v) noexcept {
 		return {
 			std::ceil(v.m_x),
 			std::ceil(v.m_y),
@@ -340,8 +364,9 @@ namespace smallpt {
 		};
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 Trunc(const Vector3& v) noexcept {
+	inline const BasicVector3< T > Trunc(const BasicVector3< T >& v) noexcept {
 		return {
 			std::trunc(v.m_x),
 			std::trunc(v.m_y),
@@ -349,10 +374,11 @@ namespace smallpt {
 		};
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	constexpr const Vector3 Clamp(const Vector3& v, 
-								  double low = 0.0, 
-								  double high = 1.0) noexcept {
+	constexpr const BasicVector3< T > Clamp(const BasicVector3< T >& v, 
+											std::type_identity_t< T > low = T(0),
+											std::type_identity_t< T > high = T(1)) noexcept {
 		
 		return {
 			std::clamp(v.m_x, low, high),
@@ -360,23 +386,25 @@ namespace smallpt {
 			std::clamp(v.m_z, low, high) }
 		;
 	}
+	template< typename T >
 	[[nodiscard]]
-	constexpr const Vector3 Lerp(double a, 
-								 const Vector3& v1, 
-								 const Vector3& v2) noexcept {
+	constexpr const BasicVector3< T > Lerp(std::type_identity_t< T > a, 
+										   const BasicVector3< T >& v1,
+										   const BasicVector3< T >& v2) noexcept {
 
 		return v1 + a * (v2 - v1);
 	}
 	
-	template< std::size_t X, std::size_t Y, std::size_t Z >
+	template< std::size_t X, std::size_t Y, std::size_t Z, typename T >
 	[[nodiscard]]
-	constexpr const Vector3 Permute(const Vector3& v) noexcept {
+	constexpr const BasicVector3< T > Permute(const BasicVector3< T >& v) noexcept {
 		return { v[X], v[Y], v[Z] };
 	}
 	
+	template< typename T >
 	[[nodiscard]]
-	inline const Vector3 Normalize(const Vector3& v) noexcept {
-		const double a = 1.0 / v.Norm2();
+	inline const BasicVector3< T > Normalize(const BasicVector3< T >& v) noexcept {
+		const T a = T(1) / v.Norm2();
 		return a * v;
 	}
 }
@@ -0,0 +1,441 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "bvh.hpp"
+#include "packet.hpp"
+#include "ray_sort.hpp"
+#include "rng.hpp"
+#include "sampling.hpp"
+#include "scene.hpp"
+#include "specular.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: PathStates
+	//-------------------------------------------------------------------------
+
+	// A camera ray and the index of the radiance sum its path adds to.
+	struct CameraSample {
+		Ray m_ray;
+		std::size_t m_target;
+	};
+
+	// The states of the paths in flight, as a structure of arrays: the ray
+	// of the current segment with its closest hit, the throughput F, the
+	// radiance L gathered so far and the radiance sum it is added to.
+	struct PathStates {
+
+		void resize(std::size_t capacity) {
+			for (std::vector< double >* component : { &m_ox, &m_oy, &m_oz, &m_dx, &m_dy, &m_dz, &m_tmax,
+													 &m_fx, &m_fy, &m_fz, &m_lx, &m_ly, &m_lz }) {
+				component->resize(capacity);
+			}
+			m_depth.resize(capacity);
+			m_hit.resize(capacity);
+			m_target.resize(capacity);
+		}
+
+		void Set(std::size_t i, const CameraSample& sample) noexcept {
+			SetRay(i, sample.m_ray);
+			m_fx[i] = m_fy[i] = m_fz[i] = 1.0;
+			m_lx[i] = m_ly[i] = m_lz[i] = 0.0;
+			m_target[i] = sample.m_target;
+		}
+
+		void SetRay(std::size_t i, const Ray& ray) noexcept {
+			m_ox[i]    = ray.m_o.m_x;
+			m_oy[i]    = ray.m_o.m_y;
+			m_oz[i]    = ray.m_o.m_z;
+			m_dx[i]    = ray.m_d.m_x;
+			m_dy[i]    = ray.m_d.m_y;
+			m_dz[i]    = ray.m_d.m_z;
+			m_tmax[i]  = ray.m_tmax;
+			m_depth[i] = ray.m_depth;
+		}
+
+		// Copies the state of path i of paths to the slot j.
+		void Copy(std::size_t j, const PathStates& paths, std::size_t i) noexcept {
+			m_ox[j]     = paths.m_ox[i];
+			m_oy[j]     = paths.m_oy[i];
+			m_oz[j]     = paths.m_oz[i];
+			m_dx[j]     = paths.m_dx[i];
+			m_dy[j]     = paths.m_dy[i];
+			m_dz[j]     = paths.m_dz[i];
+			m_tmax[j]   = paths.m_tmax[i];
+			m_fx[j]     = paths.m_fx[i];
+			m_fy[j]     = paths.m_fy[i];
+			m_fz[j]     = paths.m_fz[i];
+			m_lx[j]     = paths.m_lx[i];
+			m_ly[j]     = paths.m_ly[i];
+			m_lz[j]     = paths.m_lz[i];
+			m_depth[j]  = paths.m_depth[i];
+			m_hit[j]    = paths.m_hit[i];
+			m_target[j] = paths.m_target[i];
+		}
+
+		[[nodiscard]]
+		const Ray GetRay(std::size_t i) const noexcept {
+			return Ray(Vector3(m_ox[i], m_oy[i], m_oz[i]),
+					   Vector3(m_dx[i], m_dy[i], m_dz[i]),
+					   EPSILON_SPHERE, m_tmax[i], m_depth[i]);
+		}
+
+		std::vector< double > m_ox, m_oy, m_oz;
+		std::vector< double > m_dx, m_dy, m_dz;
+		std::vector< double > m_tmax;
+		std::vector< double > m_fx, m_fy, m_fz;
+		std::vector< double > m_lx, m_ly, m_lz;
+		std::vector< std::uint32_t > m_depth;
+		std::vector< std::int32_t > m_hit; // -1 for a miss
+		std::vector< std::size_t > m_target;
+	};
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Wavefront
+	//-------------------------------------------------------------------------
+
+	// A path tracer that advances up to capacity paths together, one stage
+	// at a time over all of them, instead of one path at a time through all
+	// the stages (as Radiance does). The states of the paths in flight stay
+	// packed at the front of the buffers, and every bounce runs:
+	//  - generate: new camera paths fill the free slots at the back;
+	//  - sort (optional): the paths are reordered by the origin and the
+	//    direction of their rays (see RayKey), so consecutive packets
+	//    traverse the same parts of the scene;
+	//  - extend: the rays of all paths are intersected, in packets;
+	//  - roulette and compaction: the paths that missed or lost the Russian
+	//    roulette finish, and the others are packed and queued by their 
+	//    reflection type;
+	//  - shade: each queue samples the next ray of its paths.
+	// The paths are the ones of Radiance: both estimate the same image. The
+	// stages run in chunks with parallel_for (see SerialFor), each drawing
+	// from its own random stream, except the serial compaction. 
+	//
+	// Every stage streams over all the states, so they should fit in the
+	// caches: beyond some ten thousand paths, the stages wait on memory.
+	class Wavefront {
+
+	public:
+
+		//---------------------------------------------------------------------
+		// Class Member Variables
+		//---------------------------------------------------------------------
+
+		static constexpr std::size_t g_default_capacity = 4096u;
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		explicit Wavefront(std::size_t capacity = g_default_capacity, bool sort_rays = false)
+			: m_paths(),
+			m_sorted_paths(),
+			m_capacity(std::max(std::size_t(1u), capacity)),
+			m_sort_rays(sort_rays),
+			m_queues() {
+
+			m_paths.resize(m_capacity);
+			if (m_sort_rays) {
+				m_sorted_paths.resize(m_capacity);
+			}
+			for (std::vector< std::uint32_t >& queue : m_queues) {
+				queue.reserve(m_capacity);
+			}
+		}
+		Wavefront(const Wavefront& wavefront) = default;
+		Wavefront(Wavefront&& wavefront) noexcept = default;
+		~Wavefront() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		Wavefront& operator=(const Wavefront& wavefront) = default;
+		Wavefront& operator=(Wavefront&& wavefront) noexcept = default;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		// Traces nb_paths paths through the scene, starting at the camera
+		// samples generate(k, rng) returns for k in [0, nb_paths), and adds
+		// the radiance of each path to Ls_sums[m_target]. Returns the number
+		// of rays intersected.
+		template< typename GenerateT, typename ParallelForT = SerialFor >
+		std::uint64_t Trace(const Scene& scene,
+							std::size_t nb_paths,
+							const GenerateT& generate,
+							Vector3* Ls_sums,
+							std::uint32_t seed = g_default_seed,
+							const ParallelForT& parallel_for = {}) {
+
+			std::uint64_t nb_rays = 0u;
+			std::uint32_t stream  = 0u;
+			std::size_t nb_active = 0u;
+			for (std::size_t next_path = 0u; true; ) {
+				// Generate
+				const std::size_t nb_new_paths = std::min(m_capacity - nb_active, nb_paths - next_path);
+				ForEachChunk(nb_new_paths, seed, stream, parallel_for,
+							 [this, &generate, nb_active, next_path](std::size_t j, RNG& rng) noexcept {
+					m_paths.Set(nb_active + j, generate(next_path + j, rng));
+				});
+				next_path += nb_new_paths;
+				nb_active += nb_new_paths;
+
+				if (0u == nb_active) {
+					return nb_rays;
+				}
+
+				// Sort
+				if (m_sort_rays) {
+					SortRays(nb_active, parallel_for);
+				}
+
+				// Extend
+				nb_rays += nb_active;
+				Extend(scene, nb_active, parallel_for);
+
+				// Roulette and compaction
+				RNG rng(seed, stream++);
+				for (std::vector< std::uint32_t >& queue : m_queues) {
+					queue.clear();
+				}
+				std::size_t nb_alive = 0u;
+				for (std::size_t i = 0u; i < nb_active; ++i) {
+					if (0 > m_paths.m_hit[i]) {
+						Finish(i, Ls_sums);
+						continue;
+					}
+
+					const Material& material = scene.GetMaterial(static_cast< std::size_t >(m_paths.m_hit[i]));
+					if (!Roulette(material, i, rng)) {
+						Finish(i, Ls_sums);
+						continue;
+					}
+
+					if (nb_alive != i) {
+						m_paths.Copy(nb_alive, m_paths, i);
+					}
+					m_queues[static_cast< std::size_t >(material.m_reflection_t)].push_back(static_cast< std::uint32_t >(nb_alive));
+					++nb_alive;
+				}
+				nb_active = nb_alive;
+
+				// Shade
+				ShadeQueue< Reflection_t::Diffuse >(scene, seed, stream, parallel_for);
+				ShadeQueue< Reflection_t::Specular >(scene, seed, stream, parallel_for);
+				ShadeQueue< Reflection_t::Refractive >(scene, seed, stream, parallel_for);
+			}
+		}
+
+	private:
+
+		//---------------------------------------------------------------------
+		// Class Member Variables
+		//---------------------------------------------------------------------
+
+		// The number of paths a stage handles per task.
+		static constexpr std::size_t g_chunk_size = 256u;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		// Calls body(j, rng) for every j in [0, n), in chunks run with
+		// parallel_for. Every chunk draws from its own random stream.
+		template< typename ParallelForT, typename BodyT >
+		static void ForEachChunk(std::size_t n,
+								 std::uint32_t seed,
+								 std::uint32_t& stream,
+								 const ParallelForT& parallel_for,
+								 const BodyT& body) {
+			const std::size_t nb_chunks     = (n + g_chunk_size - 1u) / g_chunk_size;
+			const std::uint32_t first_stream = stream;
+			stream += static_cast< std::uint32_t >(nb_chunks);
+
+			parallel_for(nb_chunks, [n, seed, first_stream, &body](std::size_t chunk) noexcept {
+				RNG rng(seed, first_stream + chunk);
+				const std::size_t end = std::min(n, (chunk + 1u) * g_chunk_size);
+				for (std::size_t j = chunk * g_chunk_size; j < end; ++j) {
+					body(j, rng);
+				}
+			});
+		}
+
+		// Reorders the first n paths by the RayKey of their rays, with the 
+		// origins quantized over their bounds.
+		template< typename ParallelForT >
+		void SortRays(std::size_t n, const ParallelForT& parallel_for) {
+			Vector3 origin_min(std::numeric_limits< double >::infinity());
+			Vector3 origin_max(-std::numeric_limits< double >::infinity());
+			for (std::size_t i = 0u; i < n; ++i) {
+				const Vector3 o(m_paths.m_ox[i], m_paths.m_oy[i], m_paths.m_oz[i]);
+				origin_min = Min(origin_min, o);
+				origin_max = Max(origin_max, o);
+			}
+			const Vector3 origin_scale = 512.0 / Max(origin_max - origin_min, Vector3(1e-9));
+
+			std::vector< std::uint32_t > keys(n);
+			std::vector< std::uint32_t > order(n);
+			const std::size_t nb_chunks = (n + g_chunk_size - 1u) / g_chunk_size;
+			parallel_for(nb_chunks, [this, &keys, &order, &origin_min, &origin_scale, n](std::size_t chunk) noexcept {
+				const std::size_t end = std::min(n, (chunk + 1u) * g_chunk_size);
+				for (std::size_t i = chunk * g_chunk_size; i < end; ++i) {
+					keys[i]  = RayKey(m_paths.GetRay(i), origin_min, origin_scale);
+					order[i] = static_cast< std::uint32_t >(i);
+				}
+			});
+
+			RadixSort(keys, order, g_ray_key_bits, parallel_for);
+
+			parallel_for(nb_chunks, [this, &order, n](std::size_t chunk) noexcept {
+				const std::size_t end = std::min(n, (chunk + 1u) * g_chunk_size);
+				for (std::size_t j = chunk * g_chunk_size; j < end; ++j) {
+					m_sorted_paths.Copy(j, m_paths, order[j]);
+				}
+			});
+			std::swap(m_paths, m_sorted_paths);
+		}
+
+		// Intersects the rays of the first n paths, a packet at a time.
+		template< typename ParallelForT >
+		void Extend(const Scene& scene, std::size_t n, const ParallelForT& parallel_for) {
+			const std::size_t nb_chunks = (n + g_chunk_size - 1u) / g_chunk_size;
+
+			parallel_for(nb_chunks, [this, &scene, n](std::size_t chunk) noexcept {
+				const std::size_t end = std::min(n, (chunk + 1u) * g_chunk_size);
+				RayPacket packet;
+				for (std::size_t begin = chunk * g_chunk_size; begin < end; begin += g_packet_size) {
+					const std::size_t packet_end = std::min(end, begin + g_packet_size);
+					for (std::size_t j = begin; j < packet_end; ++j) {
+						packet.push_back(m_paths.GetRay(j));
+					}
+
+					scene.Intersect(packet);
+
+					for (std::size_t j = begin; j < packet_end; ++j) {
+						const std::size_t lane = j - begin;
+						const std::optional< std::size_t > hit = packet.GetHit(lane);
+						m_paths.m_tmax[j] = packet.m_tmax[lane];
+						m_paths.m_hit[j]  = hit ? static_cast< std::int32_t >(hit.value()) : -1;
+					}
+					packet.clear();
+				}
+			});
+		}
+
+		// Adds the radiance of path i to its sum.
+		void Finish(std::size_t i, Vector3* Ls_sums) const noexcept {
+			Ls_sums[m_paths.m_target[i]] += Vector3(m_paths.m_lx[i], m_paths.m_ly[i], m_paths.m_lz[i]);
+		}
+
+		// Adds the emission of the material path i hit and applies its
+		// reflectance and the Russian roulette (as Radiance does). Returns
+		// whether the path continues.
+		[[nodiscard]]
+		bool Roulette(const Material& material, std::size_t i, RNG& rng) noexcept {
+			Vector3 F(m_paths.m_fx[i], m_paths.m_fy[i], m_paths.m_fz[i]);
+			Vector3 L = Vector3(m_paths.m_lx[i], m_paths.m_ly[i], m_paths.m_lz[i]) + F * material.m_e;
+			F *= material.m_f;
+
+			bool active = true;
+			if (4u < m_paths.m_depth[i]) {
+				const double continue_probability = material.m_f.Max();
+				if (rng.Uniform() >= continue_probability) {
+					active = false;
+				}
+				else {
+					F /= continue_probability;
+				}
+			}
+
+			m_paths.m_fx[i] = F.m_x;
+			m_paths.m_fy[i] = F.m_y;
+			m_paths.m_fz[i] = F.m_z;
+			m_paths.m_lx[i] = L.m_x;
+			m_paths.m_ly[i] = L.m_y;
+			m_paths.m_lz[i] = L.m_z;
+			return active;
+		}
+
+		// Samples the next rays of the paths in the queue of ReflectionT.
+		template< Reflection_t ReflectionT, typename ParallelForT >
+		void ShadeQueue(const Scene& scene,
+						std::uint32_t seed,
+						std::uint32_t& stream,
+						const ParallelForT& parallel_for) {
+			const std::vector< std::uint32_t >& queue = m_queues[static_cast< std::size_t >(ReflectionT)];
+			ForEachChunk(queue.size(), seed, stream, parallel_for,
+						 [this, &scene, &queue](std::size_t j, RNG& rng) noexcept {
+				Shade< ReflectionT >(scene, queue[j], rng);
+			});
+		}
+
+		// Samples the next ray of path i, which hit a surface of ReflectionT.
+		template< Reflection_t ReflectionT >
+		void Shade(const Scene& scene, std::size_t i, RNG& rng) noexcept {
+			const Ray r = m_paths.GetRay(i);
+			const Vector3 p = r(r.m_tmax);
+			const Vector3 n = scene.GetNormal(static_cast< std::size_t >(m_paths.m_hit[i]), p);
+			constexpr double infinity = std::numeric_limits< double >::infinity();
+
+			if constexpr (Reflection_t::Specular == ReflectionT) {
+				const Vector3 d = IdealSpecularReflect(r.m_d, n);
+				m_paths.SetRay(i, Ray(p, d, EPSILON_SPHERE, infinity, r.m_depth + 1u));
+			}
+			else if constexpr (Reflection_t::Refractive == ReflectionT) {
+				double pr;
+				const Vector3 d = IdealSpecularTransmit(r.m_d, n, g_refractive_index_out, g_refractive_index_in, pr, rng);
+				m_paths.m_fx[i] *= pr;
+				m_paths.m_fy[i] *= pr;
+				m_paths.m_fz[i] *= pr;
+				m_paths.SetRay(i, Ray(p, d, EPSILON_SPHERE, infinity, r.m_depth + 1u));
+			}
+			else {
+				const Vector3 w = (0.0 > n.Dot(r.m_d)) ? n : -n;
+				const Vector3 u = Normalize((std::abs(w.m_x) > 0.1 ? Vector3(0.0, 1.0, 0.0) : Vector3(1.0, 0.0, 0.0)).Cross(w));
+				const Vector3 v = w.Cross(u);
+
+				const Vector3 sample_d = CosineWeightedSampleOnHemisphere(rng.Uniform(), rng.Uniform());
+				const Vector3 d = Normalize(sample_d.m_x * u + sample_d.m_y * v + sample_d.m_z * w);
+				m_paths.SetRay(i, Ray(p, d, EPSILON_SPHERE, infinity, r.m_depth + 1u));
+			}
+		}
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		PathStates m_paths;
+		PathStates m_sorted_paths; // the buffers SortRays reorders into
+		std::size_t m_capacity;
+		bool m_sort_rays;
+		std::vector< std::uint32_t > m_queues[3u]; // per Reflection_t
+	};
+}
@@ -0,0 +1,634 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include "bvh.hpp"
+#include "packet.hpp"
+#include "simd.hpp"
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// System Includes
+//-----------------------------------------------------------------------------
+#pragma region
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#pragma endregion
+
+//-----------------------------------------------------------------------------
+// Declarations and Definitions
+//-----------------------------------------------------------------------------
+namespace smallpt {
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: WideBVHNode
+	//-------------------------------------------------------------------------
+
+	constexpr std::size_t g_bvh_width = 8u;
+
+	// A node with up to g_bvh_width children. The bounds of the children are
+	// stored with 8 bits per coordinate on a grid over the node: along axis a,
+	// child c spans [m_origin[a] + m_qmin[a][c] * 2^m_exponent[a],
+	// m_origin[a] + m_qmax[a][c] * 2^m_exponent[a]], which contains its exact
+	// bounds.
+	struct alignas(64) WideBVHNode {
+
+		[[nodiscard]]
+		bool IsLeaf(std::size_t child) const noexcept {
+			return 0u < m_nb_primitives[child];
+		}
+
+		double m_origin[3];
+		std::int16_t m_exponent[3];
+		std::uint8_t m_nb_children;
+		std::uint8_t m_qmin[3][g_bvh_width];
+		std::uint8_t m_qmax[3][g_bvh_width];
+		std::uint32_t m_child[g_bvh_width];         // leaf: first primitive, interior: node
+		std::uint16_t m_nb_primitives[g_bvh_width]; // 0 for interior children
+	};
+
+	static_assert(128u == sizeof(WideBVHNode), "A wide BVH node should fill two cache lines.");
+
+	// 2^exponent for the exponents of normal doubles.
+	[[nodiscard]]
+	inline double QuantizationScale(std::int16_t exponent) noexcept {
+		return std::bit_cast< double >(static_cast< std::uint64_t >(exponent + 1023) << 52);
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: Node Kernels
+	//-------------------------------------------------------------------------
+
+	// Tests the ray o + t * d, given inv_d = 1 / d, on [tmin, tmax] against the
+	// bounds of all children of the node (like AABB::Intersect). Returns the
+	// mask of the children hit, and stores their entry distances in t_entries
+	// (which holds g_bvh_width values).
+	using WideNodeKernel = std::uint32_t (*)(const WideBVHNode& node,
+											 const Vector3& o,
+											 const Vector3& inv_d,
+											 double tmin,
+											 double tmax,
+											 double* t_entries) noexcept;
+
+	// Widening the exit distance makes the test conservative with respect to
+	// the rounding errors of the slab distances.
+	constexpr double g_wide_exit_scale = 1.0 + 6.0 * std::numeric_limits< double >::epsilon();
+
+	[[nodiscard]]
+	inline std::uint32_t IntersectWideNodeScalar(const WideBVHNode& node,
+												 const Vector3& o,
+												 const Vector3& inv_d,
+												 double tmin,
+												 double tmax,
+												 double* t_entries) noexcept {
+		std::uint32_t hits = 0u;
+		for (std::size_t c = 0u; c < node.m_nb_children; ++c) {
+			double t_near = tmin;
+			double t_far  = tmax;
+			for (std::size_t a = 0u; a < 3u; ++a) {
+				const double scale = QuantizationScale(node.m_exponent[a]);
+				const double lo = node.m_origin[a] + node.m_qmin[a][c] * scale;
+				const double hi = node.m_origin[a] + node.m_qmax[a][c] * scale;
+				double t0 = (lo - o[a]) * inv_d[a];
+				double t1 = (hi - o[a]) * inv_d[a];
+				if (t0 > t1) {
+					std::swap(t0, t1);
+				}
+				t1 *= g_wide_exit_scale;
+
+				// A NaN slab distance (0 * inf) leaves the interval unchanged.
+				t_near = (t0 > t_near) ? t0 : t_near;
+				t_far  = (t1 < t_far)  ? t1 : t_far;
+			}
+
+			if (t_near <= t_far) {
+				t_entries[c] = t_near;
+				hits |= 1u << c;
+			}
+		}
+
+		return hits;
+	}
+
+	#ifdef SMALLPT_X86
+
+	// The min and max instructions return their second operand if either is
+	// NaN, which matches the scalar kernel with the operand orders below.
+
+	[[nodiscard]]
+	SMALLPT_TARGET("sse2")
+	inline std::uint32_t IntersectWideNodeSSE2(const WideBVHNode& node,
+											   const Vector3& o,
+											   const Vector3& inv_d,
+											   double tmin,
+											   double tmax,
+											   double* t_entries) noexcept {
+		const __m128d exit_scale = _mm_set1_pd(g_wide_exit_scale);
+
+		std::uint32_t hits = 0u;
+		for (std::size_t c = 0u; c < node.m_nb_children; c += 2u) {
+			__m128d t_near = _mm_set1_pd(tmin);
+			__m128d t_far  = _mm_set1_pd(tmax);
+			for (std::size_t a = 0u; a < 3u; ++a) {
+				const __m128d origin = _mm_set1_pd(node.m_origin[a]);
+				const __m128d scale  = _mm_set1_pd(QuantizationScale(node.m_exponent[a]));
+				const __m128d qmin = _mm_set_pd(node.m_qmin[a][c + 1u], node.m_qmin[a][c]);
+				const __m128d qmax = _mm_set_pd(node.m_qmax[a][c + 1u], node.m_qmax[a][c]);
+				const __m128d lo = _mm_add_pd(origin, _mm_mul_pd(qmin, scale));
+				const __m128d hi = _mm_add_pd(origin, _mm_mul_pd(qmax, scale));
+
+				const __m128d oa = _mm_set1_pd(o[a]);
+				const __m128d inv_da = _mm_set1_pd(inv_d[a]);
+				const __m128d t0 = _mm_mul_pd(_mm_sub_pd(lo, oa), inv_da);
+				const __m128d t1 = _mm_mul_pd(_mm_sub_pd(hi, oa), inv_da);
+				t_near = _mm_max_pd(_mm_min_pd(t1, t0), t_near);
+				t_far  = _mm_min_pd(_mm_mul_pd(_mm_max_pd(t0, t1), exit_scale), t_far);
+			}
+
+			_mm_storeu_pd(&t_entries[c], t_near);
+			hits |= static_cast< std::uint32_t >(_mm_movemask_pd(_mm_cmple_pd(t_near, t_far))) << c;
+		}
+
+		return hits & ((1u << node.m_nb_children) - 1u);
+	}
+
+	[[nodiscard]]
+	SMALLPT_TARGET("avx2")
+	inline std::uint32_t IntersectWideNodeAVX2(const WideBVHNode& node,
+											   const Vector3& o,
+											   const Vector3& inv_d,
+											   double tmin,
+											   double tmax,
+											   double* t_entries) noexcept {
+		const __m256d exit_scale = _mm256_set1_pd(g_wide_exit_scale);
+
+		std::uint32_t hits = 0u;
+		for (std::size_t c = 0u; c < node.m_nb_children; c += 4u) {
+			__m256d t_near = _mm256_set1_pd(tmin);
+			__m256d t_far  = _mm256_set1_pd(tmax);
+			for (std::size_t a = 0u; a < 3u; ++a) {
+				std::int32_t qmin_bytes, qmax_bytes;
+				std::memcpy(&qmin_bytes, &node.m_qmin[a][c], sizeof(qmin_bytes));
+				std::memcpy(&qmax_bytes, &node.m_qmax[a][c], sizeof(qmax_bytes));
+
+				const __m256d origin = _mm256_set1_pd(node.m_origin[a]);
+				const __m256d scale  = _mm256_set1_pd(QuantizationScale(node.m_exponent[a]));
+				const __m256d qmin = _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(qmin_bytes)));
+				const __m256d qmax = _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(qmax_bytes)));
+				const __m256d lo = _mm256_add_pd(origin, _mm256_mul_pd(qmin, scale));
+				const __m256d hi = _mm256_add_pd(origin, _mm256_mul_pd(qmax, scale));
+
+				const __m256d oa = _mm256_set1_pd(o[a]);
+				const __m256d inv_da = _mm256_set1_pd(inv_d[a]);
+				const __m256d t0 = _mm256_mul_pd(_mm256_sub_pd(lo, oa), inv_da);
+				const __m256d t1 = _mm256_mul_pd(_mm256_sub_pd(hi, oa), inv_da);
+				t_near = _mm256_max_pd(_mm256_min_pd(t1, t0), t_near);
+				t_far  = _mm256_min_pd(_mm256_mul_pd(_mm256_max_pd(t0, t1), exit_scale), t_far);
+			}
+
+			_mm256_storeu_pd(&t_entries[c], t_near);
+			hits |= static_cast< std::uint32_t >(_mm256_movemask_pd(_mm256_cmp_pd(t_near, t_far, _CMP_LE_OQ))) << c;
+		}
+
+		return hits & ((1u << node.m_nb_children) - 1u);
+	}
+
+	SMALLPT_BEGIN_AVX512_KERNELS
+
+	[[nodiscard]]
+	SMALLPT_TARGET("avx512f")
+	inline std::uint32_t IntersectWideNodeAVX512(const WideBVHNode& node,
+												 const Vector3& o,
+												 const Vector3& inv_d,
+												 double tmin,
+												 double tmax,
+												 double* t_entries) noexcept {
+		const __m512d exit_scale = _mm512_set1_pd(g_wide_exit_scale);
+
+		__m512d t_near = _mm512_set1_pd(tmin);
+		__m512d t_far  = _mm512_set1_pd(tmax);
+		for (std::size_t a = 0u; a < 3u; ++a) {
+			const __m512d origin = _mm512_set1_pd(node.m_origin[a]);
+			const __m512d scale  = _mm512_set1_pd(QuantizationScale(node.m_exponent[a]));
+			const __m512i qmin_bytes = _mm512_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast< const __m128i* >(node.m_qmin[a])));
+			const __m512i qmax_bytes = _mm512_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast< const __m128i* >(node.m_qmax[a])));
+			const __m512d qmin = _mm512_cvtepi32_pd(_mm512_castsi512_si256(qmin_bytes));
+			const __m512d qmax = _mm512_cvtepi32_pd(_mm512_castsi512_si256(qmax_bytes));
+			const __m512d lo = _mm512_add_pd(origin, _mm512_mul_pd(qmin, scale));
+			const __m512d hi = _mm512_add_pd(origin, _mm512_mul_pd(qmax, scale));
+
+			const __m512d oa = _mm512_set1_pd(o[a]);
+			const __m512d inv_da = _mm512_set1_pd(inv_d[a]);
+			const __m512d t0 = _mm512_mul_pd(_mm512_sub_pd(lo, oa), inv_da);
+			const __m512d t1 = _mm512_mul_pd(_mm512_sub_pd(hi, oa), inv_da);
+			t_near = _mm512_max_pd(_mm512_min_pd(t1, t0), t_near);
+			t_far  = _mm512_min_pd(_mm512_mul_pd(_mm512_max_pd(t0, t1), exit_scale), t_far);
+		}
+
+		const __mmask8 children = static_cast< __mmask8 >((1u << node.m_nb_children) - 1u);
+		_mm512_storeu_pd(t_entries, t_near);
+		return static_cast< std::uint32_t >(_mm512_mask_cmp_pd_mask(children, t_near, t_far, _CMP_LE_OQ));
+	}
+
+	SMALLPT_END_AVX512_KERNELS
+
+	#endif
+
+	[[nodiscard]]
+	inline WideNodeKernel SelectWideNodeKernel(SimdLevel level) noexcept {
+		switch (level) {
+		#ifdef SMALLPT_X86
+		case SimdLevel::AVX512:
+			return IntersectWideNodeAVX512;
+		case SimdLevel::AVX2:
+			return IntersectWideNodeAVX2;
+		case SimdLevel::SSE2:
+			return IntersectWideNodeSSE2;
+		#endif
+		default:
+			return IntersectWideNodeScalar;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	// Declarations and Definitions: WideBVH
+	//-------------------------------------------------------------------------
+
+	// A compressed, g_bvh_width-ary form of a BVH, traversed like it (with the
+	// same primitive order and leaf callbacks). Every node tests all of its
+	// children with a single node kernel.
+	class WideBVH {
+
+	public:
+
+		//---------------------------------------------------------------------
+		// Constructors and Destructors
+		//---------------------------------------------------------------------
+
+		WideBVH() = default;
+		// Collapses the binary hierarchy top-down: every wide node starts from
+		// the two children of a binary node, and repeatedly replaces its
+		// interior child with the largest surface area by the two children of
+		// that child, until it has g_bvh_width children or only leaves.
+		explicit WideBVH(const BVH& bvh, SimdLevel simd_level = DetectSimdLevel())
+			: m_nodes(),
+			m_intersect_node(SelectWideNodeKernel(simd_level)) {
+
+			const std::vector< BVHNode >& nodes = bvh.GetNodes();
+			if (nodes.empty()) {
+				return;
+			}
+
+			m_nodes.reserve(nodes.size() / (g_bvh_width - 1u) + 1u);
+			m_sources.reserve(nodes.size() / (g_bvh_width - 1u) + 1u);
+			CollapseNode(nodes, 0u);
+			m_nodes.shrink_to_fit();
+			m_sources.shrink_to_fit();
+		}
+		WideBVH(const WideBVH& bvh) = default;
+		WideBVH(WideBVH&& bvh) noexcept = default;
+		~WideBVH() = default;
+
+		//---------------------------------------------------------------------
+		// Assignment Operators
+		//---------------------------------------------------------------------
+
+		WideBVH& operator=(const WideBVH& bvh) = default;
+		WideBVH& operator=(WideBVH&& bvh) noexcept = default;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		[[nodiscard]]
+		bool empty() const noexcept {
+			return m_nodes.empty();
+		}
+
+		[[nodiscard]]
+		std::size_t GetNumberOfNodes() const noexcept {
+			return m_nodes.size();
+		}
+
+		// Quantizes the children of every node again, after the binary 
+		// hierarchy this one was collapsed from was refit (without rebuilds).
+		// The nodes are processed in chunks run with parallel_for.
+		template< typename ParallelForT = SerialFor >
+		void Refit(const BVH& bvh, const ParallelForT& parallel_for = {}) {
+			const std::vector< BVHNode >& nodes = bvh.GetNodes();
+			const std::size_t nb_chunks = (m_nodes.size() + g_chunk_size - 1u) / g_chunk_size;
+			parallel_for(nb_chunks, [this, &nodes](std::size_t chunk) noexcept {
+				const std::size_t end = std::min(m_nodes.size(), (chunk + 1u) * g_chunk_size);
+				for (std::size_t i = chunk * g_chunk_size; i < end; ++i) {
+					Quantize(nodes, m_sources[i], m_nodes[i]);
+				}
+			});
+		}
+
+		// Visits the leaves the ray passes through, nearest first (see
+		// BVH::Intersect).
+		template< typename LeafT >
+		[[nodiscard]]
+		bool Intersect(const Ray& ray, LeafT&& intersect_leaf) const noexcept {
+			if (m_nodes.empty()) {
+				return false;
+			}
+
+			const Vector3 inv_d = 1.0 / ray.m_d;
+
+			struct Entry {
+				std::uint32_t m_child;
+				std::uint32_t m_nb_primitives; // 0 for nodes
+				double m_t;
+			};
+			Entry stack[g_max_stack_size];
+			std::size_t stack_size = 0u;
+			stack[stack_size++] = { 0u, 0u, ray.m_tmin };
+
+			bool found = false;
+			while (0u < stack_size) {
+				const Entry entry = stack[--stack_size];
+				if (entry.m_t > ray.m_tmax) {
+					continue;
+				}
+
+				if (0u < entry.m_nb_primitives) {
+					found |= intersect_leaf(static_cast< std::size_t >(entry.m_child),
+											static_cast< std::size_t >(entry.m_child) + entry.m_nb_primitives);
+					continue;
+				}
+
+				const WideBVHNode& node = m_nodes[entry.m_child];
+				double t_entries[g_bvh_width];
+				const std::uint32_t hits = m_intersect_node(node, ray.m_o, inv_d, ray.m_tmin, ray.m_tmax, t_entries);
+
+				// Push the children hit farthest first, so the nearest is visited next.
+				const std::size_t first = stack_size;
+				for (std::uint32_t remaining = hits; 0u != remaining; remaining &= remaining - 1u) {
+					const std::size_t c = static_cast< std::size_t >(std::countr_zero(remaining));
+					const Entry child = { node.m_child[c], node.m_nb_primitives[c], t_entries[c] };
+					std::size_t i = stack_size++;
+					for (; first < i && stack[i - 1u].m_t < child.m_t; --i) {
+						stack[i] = stack[i - 1u];
+					}
+					stack[i] = child;
+				}
+			}
+
+			return found;
+		}
+
+		// Returns whether intersect_leaf returns true for any leaf the ray
+		// passes through (see BVH::Occluded).
+		template< typename LeafT >
+		[[nodiscard]]
+		bool Occluded(const Ray& ray, LeafT&& intersect_leaf) const noexcept {
+			if (m_nodes.empty()) {
+				return false;
+			}
+
+			const Vector3 inv_d = 1.0 / ray.m_d;
+
+			struct Entry {
+				std::uint32_t m_child;
+				std::uint32_t m_nb_primitives; // 0 for nodes
+			};
+			Entry stack[g_max_stack_size];
+			std::size_t stack_size = 0u;
+			stack[stack_size++] = { 0u, 0u };
+
+			while (0u < stack_size) {
+				const Entry entry = stack[--stack_size];
+				if (0u < entry.m_nb_primitives) {
+					if (intersect_leaf(static_cast< std::size_t >(entry.m_child),
+									   static_cast< std::size_t >(entry.m_child) + entry.m_nb_primitives)) {
+						return true;
+					}
+					continue;
+				}
+
+				const WideBVHNode& node = m_nodes[entry.m_child];
+				double t_entries[g_bvh_width];
+				const std::uint32_t hits = m_intersect_node(node, ray.m_o, inv_d, ray.m_tmin, ray.m_tmax, t_entries);
+				for (std::uint32_t remaining = hits; 0u != remaining; remaining &= remaining - 1u) {
+					const std::size_t c = static_cast< std::size_t >(std::countr_zero(remaining));
+					stack[stack_size++] = { node.m_child[c], node.m_nb_primitives[c] };
+				}
+			}
+
+			return false;
+		}
+
+		// Visits the leaves any active ray of the packet passes through (see
+		// BVH::Intersect). The children of a node are visited in the order of
+		// their entry distance along the first ray entering them.
+		template< typename LeafT >
+		void Intersect(RayPacket& packet, LeafT&& intersect_leaf) const noexcept {
+			if (m_nodes.empty() || 0u == packet.m_active_lanes) {
+				return;
+			}
+
+			Vector3 inv_ds[g_packet_size];
+			for (std::size_t lane = 0u; lane < packet.size(); ++lane) {
+				inv_ds[lane] = 1.0 / Vector3(packet.m_dx[lane], packet.m_dy[lane], packet.m_dz[lane]);
+			}
+
+			struct Entry {
+				std::uint32_t m_child;
+				std::uint32_t m_nb_primitives; // 0 for nodes
+				std::uint32_t m_lanes;
+				double m_t;
+			};
+			Entry stack[g_max_stack_size];
+			std::size_t stack_size = 0u;
+			stack[stack_size++] = { 0u, 0u, packet.m_active_lanes, 0.0 };
+
+			const std::uint32_t active_lanes = packet.m_active_lanes;
+			while (0u < stack_size) {
+				const Entry entry = stack[--stack_size];
+
+				if (0u < entry.m_nb_primitives) {
+					packet.m_active_lanes = entry.m_lanes;
+					intersect_leaf(static_cast< std::size_t >(entry.m_child),
+								   static_cast< std::size_t >(entry.m_child) + entry.m_nb_primitives,
+								   packet);
+					packet.m_active_lanes = active_lanes;
+					continue;
+				}
+
+				const WideBVHNode& node = m_nodes[entry.m_child];
+				std::uint32_t child_lanes[g_bvh_width] = {};
+				double child_ts[g_bvh_width];
+				for (std::uint32_t remaining = entry.m_lanes; 0u != remaining; remaining &= remaining - 1u) {
+					const std::size_t lane = static_cast< std::size_t >(std::countr_zero(remaining));
+					const Vector3 o(packet.m_ox[lane], packet.m_oy[lane], packet.m_oz[lane]);
+					double t_entries[g_bvh_width];
+					const std::uint32_t hits = m_intersect_node(node, o, inv_ds[lane],
+																packet.m_tmin[lane], packet.m_tmax[lane], t_entries);
+					for (std::uint32_t c_hits = hits; 0u != c_hits; c_hits &= c_hits - 1u) {
+						const std::size_t c = static_cast< std::size_t >(std::countr_zero(c_hits));
+						if (0u == child_lanes[c]) {
+							child_ts[c] = t_entries[c];
+						}
+						child_lanes[c] |= 1u << lane;
+					}
+				}
+
+				const std::size_t first = stack_size;
+				for (std::size_t c = 0u; c < node.m_nb_children; ++c) {
+					if (0u == child_lanes[c]) {
+						continue;
+					}
+
+					const Entry child = { node.m_child[c], node.m_nb_primitives[c], child_lanes[c], child_ts[c] };
+					std::size_t i = stack_size++;
+					for (; first < i && stack[i - 1u].m_t < child.m_t; --i) {
+						stack[i] = stack[i - 1u];
+					}
+					stack[i] = child;
+				}
+			}
+		}
+
+	private:
+
+		//---------------------------------------------------------------------
+		// Class Member Variables
+		//---------------------------------------------------------------------
+
+		// Every level below the root leaves at most g_bvh_width - 1 entries on
+		// the stack, and the wide hierarchy is no deeper than the binary one.
+		static constexpr std::size_t g_max_stack_size = (g_bvh_width - 1u) * 128u + 1u;
+		// The number of nodes refit by a single task.
+		static constexpr std::size_t g_chunk_size = 1024u;
+
+		//---------------------------------------------------------------------
+		// Member Methods
+		//---------------------------------------------------------------------
+
+		// The binary nodes a wide node was collapsed from.
+		struct Source {
+			std::uint32_t m_node;
+			std::uint32_t m_children[g_bvh_width];
+		};
+
+		std::uint32_t CollapseNode(const std::vector< BVHNode >& nodes, std::uint32_t index) {
+			const std::uint32_t wide_index = static_cast< std::uint32_t >(m_nodes.size());
+			m_nodes.emplace_back();
+			m_sources.emplace_back();
+
+			std::uint32_t children[g_bvh_width];
+			std::size_t nb_children = 0u;
+			if (nodes[index].IsLeaf()) {
+				children[nb_children++] = index;
+			}
+			else {
+				children[nb_children++] = index + 1u;
+				children[nb_children++] = nodes[index].m_offset;
+			}
+
+			while (nb_children < g_bvh_width) {
+				std::size_t largest = nb_children;
+				double largest_area = -1.0;
+				for (std::size_t c = 0u; c < nb_children; ++c) {
+					const BVHNode& child = nodes[children[c]];
+					if (!child.IsLeaf() && largest_area < child.m_bounds.SurfaceArea()) {
+						largest = c;
+						largest_area = child.m_bounds.SurfaceArea();
+					}
+				}
+
+				if (nb_children == largest) {
+					break;
+				}
+
+				const std::uint32_t child = children[largest];
+				children[largest] = child + 1u;
+				children[nb_children++] = nodes[child].m_offset;
+			}
+
+			Source& source = m_sources[wide_index];
+			source.m_node = index;
+			std::copy(children, children + nb_children, source.m_children);
+			m_nodes[wide_index].m_nb_children = static_cast< std::uint8_t >(nb_children);
+			Quantize(nodes, source, m_nodes[wide_index]);
+
+			for (std::size_t c = 0u; c < nb_children; ++c) {
+				const BVHNode& child = nodes[children[c]];
+				if (child.IsLeaf()) {
+					m_nodes[wide_index].m_child[c] = child.m_offset;
+					m_nodes[wide_index].m_nb_primitives[c] = child.m_nb_primitives;
+				}
+				else {
+					const std::uint32_t child_index = CollapseNode(nodes, children[c]);
+					m_nodes[wide_index].m_child[c] = child_index;
+					m_nodes[wide_index].m_nb_primitives[c] = 0u;
+				}
+			}
+
+			return wide_index;
+		}
+
+		static void Quantize(const std::vector< BVHNode >& nodes,
+							 const Source& source,
+							 WideBVHNode& node) noexcept {
+
+			const AABB& bounds = nodes[source.m_node].m_bounds;
+			for (std::size_t a = 0u; a < 3u; ++a) {
+				const double origin = bounds.m_min[a];
+				const double extent = bounds.m_max[a] - origin;
+
+				// The smallest scale covering the node with 255 grid steps.
+				int exponent = -1022;
+				if (0.0 < extent) {
+					std::frexp(extent / 255.0, &exponent);
+					exponent = std::max(-1022, exponent - 1);
+				}
+				while (origin + 255.0 * QuantizationScale(static_cast< std::int16_t >(exponent)) < bounds.m_max[a]) {
+					++exponent;
+				}
+
+				const double scale = QuantizationScale(static_cast< std::int16_t >(exponent));
+				node.m_origin[a] = origin;
+				node.m_exponent[a] = static_cast< std::int16_t >(exponent);
+
+				// Round outwards, checking the decoded coordinates themselves.
+				for (std::size_t c = 0u; c < node.m_nb_children; ++c) {
+					const AABB& child_bounds = nodes[source.m_children[c]].m_bounds;
+					double qmin = std::clamp(std::floor((child_bounds.m_min[a] - origin) / scale), 0.0, 255.0);
+					while (0.0 < qmin && origin + qmin * scale > child_bounds.m_min[a]) {
+						qmin -= 1.0;
+					}
+					double qmax = std::clamp(std::ceil((child_bounds.m_max[a] - origin) / scale), 0.0, 255.0);
+					while (255.0 > qmax && origin + qmax * scale < child_bounds.m_max[a]) {
+						qmax += 1.0;
+					}
+
+					node.m_qmin[a][c] = static_cast< std::uint8_t >(qmin);
+					node.m_qmax[a][c] = static_cast< std::uint8_t >(qmax);
+				}
+			}
+		}
+
+		//---------------------------------------------------------------------
+		// Member Variables
+		//---------------------------------------------------------------------
+
+		std::vector< WideBVHNode > m_nodes;
+		std::vector< Source > m_sources;
+		WideNodeKernel m_intersect_node = IntersectWideNodeScalar;
+	};
+}